@@ -2,9 +2,13 @@
 
 #include "KingSquare.h"
 
+inline namespace SIZE_NAMESPACE {
+
 class BlackKingSquare : public KingSquare
 {
  public:
   BlackKingSquare(coordinates_type square) : KingSquare(square) { }
   BlackKingSquare(int x, int y) : KingSquare(x, y) { }
 };
+
+} // namespace SIZE_NAMESPACE
@@ -2,6 +2,8 @@
 #include "BlockIndex.h"
 #include <iostream>
 
+inline namespace SIZE_NAMESPACE {
+
 #ifdef CWDEBUG
 void BlockIndex::print_on(std::ostream& os) const
 {
@@ -12,3 +14,5 @@ void BlockIndex::print_on(std::ostream& os) const
   os << '}';
 }
 #endif
+
+} // namespace SIZE_NAMESPACE
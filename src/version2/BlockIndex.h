@@ -3,7 +3,11 @@
 #include "Size.h"
 #ifdef CWDEBUG
 #include "utils/has_print_on.h"
+#endif
+
+inline namespace SIZE_NAMESPACE {
 
+#ifdef CWDEBUG
 // This class defines a print_on method.
 using utils::has_print_on::operator<<;
 #endif
@@ -22,6 +26,9 @@ class BlockIndex
 
   static constexpr index_type xy_to_index(int x, int y) { return (y / Size::block::y) * Px + (x / Size::block::x); }
 
+  // Returns a positive value if the block is below the diagonal (x > y), a negative value if it is above the diagonal and zero if it is on the diagonal.
+  static constexpr int diagonal_side(index_type index) { return static_cast<int>(index % Px) - static_cast<int>(index / Px); }
+
  private:
   index_type index_;    // Index of a Block, see ASCII art in Size.h.
 
@@ -36,7 +43,11 @@ class BlockIndex
   int x_coord() const { return (index_ % Px) * Size::block::x; }
   int y_coord() const { return (index_ / Px) * Size::block::y; }
 
+  int diagonal_side() const { return diagonal_side(index_); }
+
 #ifdef CWDEBUG
   void print_on(std::ostream& os) const;
 #endif
 };
+
+} // namespace SIZE_NAMESPACE
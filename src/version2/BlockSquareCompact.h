@@ -3,9 +3,13 @@
 #include "Size.h"
 #include "SquareCompact.h"
 
+inline namespace SIZE_NAMESPACE {
+
 class BlockSquareCompact : public SquareCompact<Size::block>
 {
  public:
   BlockSquareCompact(coordinates_type block_square) : SquareCompact<Size::block>(block_square) { }
   BlockSquareCompact(int x, int y) : SquareCompact<Size::block>(x, y) { }
 };
+
+} // namespace SIZE_NAMESPACE
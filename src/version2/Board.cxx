@@ -12,6 +12,8 @@
 #include <algorithm>
 #include "debug.h"
 
+inline namespace SIZE_NAMESPACE {
+
 // Implementation written and tested by Carlo Wood - 2025/07/19.
 //
 // Note: this function assumes it is black to move, therefore it should
@@ -1129,3 +1131,5 @@ void Board::print_on(std::ostream& os) const
    ", white rook:" << Square{white_rook()} << '}';
 }
 #endif
+
+} // namespace SIZE_NAMESPACE
@@ -11,8 +11,11 @@
 #include "utils/VectorIndex.h"
 #include <cstdint>
 #include <functional>
+#include <algorithm>
 #include "debug.h"
 
+inline namespace SIZE_NAMESPACE {
+
 #ifdef CWDEBUG
 // This class defines a print_on method.
 using utils::has_print_on::operator<<;
@@ -130,9 +133,25 @@ class Board
     return static_cast<WhiteRookSquare::coordinates_type>(encoded_ & white_rook_mask);
   }
 
+  // Only call these on a canonical board (see is_canonical).
   Partition as_partition() const { return {black_king().block_index(), white_king().block_index()}; }
   PartitionElement as_partition_element() const { return {black_king().block_square(), white_king().block_square(), white_rook()}; }
 
+  // Diagonal symmetry (only if Size::diagonal_symmetry is set).
+  //
+  // A position and its mirror image (all x and y coordinates swapped) have the same classification and ply.
+  // Only one of the two, the canonical board, is stored: the first of (black king block, white king block,
+  // black king, white king, white rook) that is not on the diagonal must be below the diagonal (x > y).
+  // If all are on the diagonal then the board is its own mirror image.
+  Board mirrored() const;
+  bool is_canonical() const;
+  Board canonical() const { return is_canonical() ? *this : mirrored(); }
+  bool is_symmetric() const { return mirrored() == *this; }
+
+  // Replace the first `number_of_neighbors` boards in `neighbors` with their canonical board and remove duplicates.
+  // Returns the new number of neighbors.
+  static int canonicalize_neighbors(neighbors_type& neighbors, int number_of_neighbors);
+
   // Convenience functions to extract the individual coordinates from the compact object returned by black_king.
   static auto x_coord(BlackKingSquare square) { return square.block_index().x_coord() + square.block_square().x_coord(); }
   static auto y_coord(BlackKingSquare square) { return square.block_index().y_coord() + square.block_square().y_coord(); }
@@ -170,12 +189,15 @@ class Board
 
   std::string get_move(Board to_board) const;
 
-  // Acccessor (used by Graph to calculate a mutex index).
+  // Acccessor.
   encoded_type get_encoded() const { return encoded_; }
 
   friend bool operator==(Board lhs, Board rhs) { return lhs.encoded_ == rhs.encoded_; }
   friend bool operator<(Board lhs, Board rhs) { return lhs.encoded_ < rhs.encoded_; }
 
+  // Gives the microbenchmarks (bench_board.cxx) access to the private kernels inc_field, dec_field, inc_king and dec_king.
+  friend struct BoardBenchmark;
+
 #ifdef CWDEBUG
   // Test member function generate_neighbors.
   static void generate_neighbors_testsuite(Graph const& graph);
@@ -395,18 +417,78 @@ class Board
   }
 };
 
+} // namespace SIZE_NAMESPACE
+
 #include "Square.h"
 #endif // BOARD_H
 
 #ifndef BOARD_defs_H
 #define BOARD_defs_H
 
+inline namespace SIZE_NAMESPACE {
+
 // Extract compact square coordinates into separate x and y coordinates for all three pieces.
 inline std::tuple<Square, Square, Square> Board::abbreviations() const
 {
   return {black_king(), white_king(), white_rook()};
 }
 
+inline Board Board::mirrored() const
+{
+  // Only square boards can be mirrored.
+  ASSERT(Size::diagonal_symmetry);
+  using namespace coordinates;
+  auto [bk, wk, wr] = abbreviations();
+  return {BlackKingSquare{bk[y], bk[x]}, WhiteKingSquare{wk[y], wk[x]}, WhiteRookSquare{wr[y], wr[x]}};
+}
+
+inline bool Board::is_canonical() const
+{
+  if constexpr (!Size::diagonal_symmetry)
+    return true;
+  else
+  {
+    // Test the partition first, so that boards in a partition that is not on the diagonal are handled quickly.
+    int side = black_king().block_index().diagonal_side();
+    if (side == 0)
+      side = white_king().block_index().diagonal_side();
+    if (side != 0)
+      return side > 0;
+    // Both kings are in a block on the diagonal.
+    using namespace coordinates;
+    auto [bk, wk, wr] = abbreviations();
+    side = bk[x] - bk[y];
+    if (side == 0)
+      side = wk[x] - wk[y];
+    if (side == 0)
+      side = wr[x] - wr[y];
+    return side >= 0;
+  }
+}
+
+//static
+inline int Board::canonicalize_neighbors(neighbors_type& neighbors, int number_of_neighbors)
+{
+  if constexpr (!Size::diagonal_symmetry)
+    return number_of_neighbors;
+  else
+  {
+    bool flipped = false;
+    for (int i = 0; i < number_of_neighbors; ++i)
+      if (!neighbors[i].is_canonical())
+      {
+        neighbors[i] = neighbors[i].mirrored();
+        flipped = true;
+      }
+    // Only a board that was flipped can be a duplicate of another board.
+    if (!flipped)
+      return number_of_neighbors;
+    auto const begin = neighbors.begin();
+    std::sort(begin, begin + number_of_neighbors);
+    return std::unique(begin, begin + number_of_neighbors) - begin;
+  }
+}
+
 template<Board::Relation relation, color_type to_move>
 void Board::generate_king_moves(neighbors_type& neighbors_out, int& neighbors) const
 {
@@ -865,4 +947,6 @@ int Board::generate_neighbors(neighbors_type& neighbors_out) const
   return neighbors;
 }
 
+} // namespace SIZE_NAMESPACE
+
 #endif // BOARD_defs_H
@@ -0,0 +1,157 @@
+#include "sys.h"
+#include "Checkpoint.h"
+#include "utils/AIAlert.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "debug.h"
+
+inline namespace SIZE_NAMESPACE {
+
+namespace {
+
+// 64-bit FNV-1a.
+class Checksum
+{
+ private:
+  uint64_t hash_ = 0xcbf29ce484222325;
+
+ public:
+  void add(void const* data, size_t size)
+  {
+    unsigned char const* bytes = static_cast<unsigned char const*>(data);
+    for (size_t i = 0; i < size; ++i)
+      hash_ = (hash_ ^ bytes[i]) * 0x100000001b3;
+  }
+
+  uint64_t value() const { return hash_; }
+};
+
+// Buffered writing to a file descriptor.
+class Writer
+{
+ private:
+  int fd_;
+  std::vector<char> buffer_;
+
+ public:
+  Writer(int fd) : fd_(fd) { buffer_.reserve(1 << 20); }
+
+  void write(void const* data, size_t size)
+  {
+    if (buffer_.size() + size > buffer_.capacity())
+      flush();
+    if (size > buffer_.capacity())
+      write_all(static_cast<char const*>(data), size);
+    else
+      buffer_.insert(buffer_.end(), static_cast<char const*>(data), static_cast<char const*>(data) + size);
+  }
+
+  void flush()
+  {
+    write_all(buffer_.data(), buffer_.size());
+    buffer_.clear();
+  }
+
+ private:
+  void write_all(char const* data, size_t size)
+  {
+    while (size > 0)
+    {
+      ssize_t written = ::write(fd_, data, size);
+      if (written < 0)
+      {
+        if (errno == EINTR)
+          continue;
+        THROW_ALERTE("write() failed");
+      }
+      data += written;
+      size -= written;
+    }
+  }
+};
+
+} // namespace
+
+void Checkpoint::write(std::filesystem::path const& filename, Frontier const& frontier) const
+{
+  std::filesystem::path tmp_filename = filename;
+  tmp_filename += ".tmp";
+
+  int fd = ::open(tmp_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1)
+    THROW_ALERTE("Could not open [FILENAME] for writing", AIArgs("[FILENAME]", tmp_filename));
+
+  Writer writer(fd);
+  Checksum checksum;
+  auto write_and_add = [&](void const* data, size_t size){
+    checksum.add(data, size);
+    writer.write(data, size);
+  };
+
+  Header header;
+  std::memcpy(header.magic, header_magic, sizeof(header.magic));
+  header.version = version;
+  header.Bx = Size::Bx;
+  header.By = Size::By;
+  header.Px = Size::Px;
+  header.Py = Size::Py;
+  header.diagonal_symmetry = Size::diagonal_symmetry;
+  header.ply = ply_;
+  header.to_move = static_cast<color_type>(to_move_);
+  write_and_add(&header, sizeof(header));
+  frontier.serialize(write_and_add);
+
+  Trailer trailer;
+  std::memcpy(trailer.magic, trailer_magic, sizeof(trailer.magic));
+  trailer.checksum = checksum.value();
+  writer.write(&trailer, sizeof(trailer));
+  writer.flush();
+
+  // Make sure the new checkpoint is on disk before it replaces the old one.
+  if (::fsync(fd) == -1)
+    THROW_ALERTE("fsync() failed");
+  ::close(fd);
+  std::filesystem::rename(tmp_filename, filename);
+}
+
+//static
+Checkpoint Checkpoint::read(std::filesystem::path const& filename, Frontier& frontier)
+{
+  std::ifstream file(filename, std::ios::binary);
+  if (!file)
+    THROW_ALERT("Could not open [FILENAME]", AIArgs("[FILENAME]", filename));
+
+  Checksum checksum;
+  auto read_and_add = [&](void* data, size_t size){
+    if (!file.read(static_cast<char*>(data), size))
+      THROW_ALERT("Checkpoint [FILENAME] is truncated", AIArgs("[FILENAME]", filename));
+    checksum.add(data, size);
+  };
+
+  Header header;
+  read_and_add(&header, sizeof(header));
+  bool const known_version = header.version == version || (header.version == 1 && PartitionElement::same_as_bit_packed);
+  if (std::memcmp(header.magic, header_magic, sizeof(header.magic)) != 0 || !known_version)
+    THROW_ALERT("[FILENAME] is not a version [VERSION] checkpoint", AIArgs("[FILENAME]", filename)("[VERSION]", version));
+  if (header.Bx != Size::Bx || header.By != Size::By || header.Px != Size::Px || header.Py != Size::Py ||
+      header.diagonal_symmetry != Size::diagonal_symmetry)
+    THROW_ALERT("Checkpoint [FILENAME] was written for a different board size", AIArgs("[FILENAME]", filename));
+  if (header.to_move != black && header.to_move != white)
+    THROW_ALERT("Checkpoint [FILENAME] is corrupt", AIArgs("[FILENAME]", filename));
+
+  frontier.deserialize(read_and_add);
+
+  Trailer trailer;
+  if (!file.read(reinterpret_cast<char*>(&trailer), sizeof(trailer)) ||
+      std::memcmp(trailer.magic, trailer_magic, sizeof(trailer.magic)) != 0 ||
+      trailer.checksum != checksum.value())
+    THROW_ALERT("Checkpoint [FILENAME] is incomplete or corrupt", AIArgs("[FILENAME]", filename));
+
+  return {header.ply, static_cast<color_type>(header.to_move)};
+}
+
+} // namespace SIZE_NAMESPACE
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Frontier.h"
+#include "../Color.h"
+#include <cstdint>
+#include <filesystem>
+
+inline namespace SIZE_NAMESPACE {
+
+// The state of the retrograde analysis at a ply boundary.
+//
+// At the start of every ply infchess2 syncs the memory mapped Info that changed to disk and then writes a Checkpoint
+// (the ply, whose move it is, and the frontier of positions that are mate in that number of ply).
+// If the solve is interrupted, `infchess2 --resume` reads the last checkpoint and continues from there
+// without having to classify all positions and seed the already mate positions again.
+//
+// The file consists of a Header, the serialized Frontier (see Frontier::serialize) and a Trailer containing
+// a checksum over everything before it. The file is written under a temporary name and renamed when complete,
+// so that a checkpoint file is either the complete previous or the complete new checkpoint.
+class Checkpoint
+{
+ public:
+  // Version 1 used a bit packed PartitionElement; see PartitionElement::same_as_bit_packed.
+  static constexpr uint32_t version = 2;
+
+ private:
+  struct Header
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t Bx, By, Px, Py;
+    uint32_t diagonal_symmetry;
+    int32_t ply;
+    uint32_t to_move;
+  };
+
+  struct Trailer
+  {
+    char magic[8];
+    uint64_t checksum;
+  };
+
+  static constexpr char header_magic[8] = { 'K', 'R', 'v', 'K', 'c', 'k', 'p', 't' };
+  static constexpr char trailer_magic[8] = { 'K', 'R', 'v', 'K', 'd', 'o', 'n', 'e' };
+
+  int ply_;                     // The frontier contains the positions that are mate in ply_ ply,
+  Color to_move_;               // with to_move_ to move.
+
+ public:
+  Checkpoint(int ply, Color to_move) : ply_(ply), to_move_(to_move) { }
+
+  static std::filesystem::path filename(std::filesystem::path const& data_directory)
+  {
+    return data_directory / "checkpoint.bin";
+  }
+
+  // Write this checkpoint, together with `frontier`, to `filename` (replacing the previous checkpoint, if any).
+  // Call Graph::sync before this, so that the Info that belongs to this checkpoint is on disk.
+  void write(std::filesystem::path const& filename, Frontier const& frontier) const;
+
+  // Read the checkpoint `filename` and store its frontier in `frontier`.
+  // Throws if the file is incomplete, corrupt, or was written for a different Size.
+  static Checkpoint read(std::filesystem::path const& filename, Frontier& frontier);
+
+  // Accessors.
+  int ply() const { return ply_; }
+  Color to_move() const { return to_move_; }
+};
+
+} // namespace SIZE_NAMESPACE
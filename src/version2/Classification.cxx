@@ -5,6 +5,8 @@
 #include "utils/endian.h"
 #include <iostream>
 
+inline namespace SIZE_NAMESPACE {
+
 void Classification::determine(Board const& board, Color to_move)
 {
   reset();
@@ -80,3 +82,5 @@ void Classification::print_on(std::ostream& os) const
   os << '}';
 }
 #endif
+
+} // namespace SIZE_NAMESPACE
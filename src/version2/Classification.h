@@ -1,16 +1,18 @@
 #pragma once
 
 #include "Size.h"
+#include "SolverCounters.h"
 #include "uint_type.h"
 #include "../Color.h"
 #include "utils/has_print_on.h"
 #include <cstdint>
 #include <string>
 #include <atomic>
-#include <mutex>
 #include <type_traits>
 #include "debug.h"
 
+inline namespace SIZE_NAMESPACE {
+
 #ifdef CWDEBUG
 // This class defines a print_on method.
 using utils::has_print_on::operator<<;
@@ -54,9 +56,13 @@ class Classification
   static constexpr encoded_type bits_mask = create_mask<encoded_type, number_of_bits>();
 
  private:
-  // mmap-ed data can not be atomic.
+  // mmap-ed data can not be std::atomic; concurrent accesses use std::atomic_ref instead.
   encoded_type encoded_;                        // <mate_in_moves><bits>
 
+  static_assert(std::atomic_ref<encoded_type>::is_always_lock_free, "Classification::encoded_ must be lock-free.");
+  static_assert(std::atomic_ref<encoded_type>::required_alignment == alignof(encoded_type),
+      "Classification::encoded_ must be sufficiently aligned to use std::atomic_ref on it.");
+
  public:
   // The default constructor should do nothing; this class is initialized by the fact
   // that this is constructed with placement-new on a memory image that already contains initialized data.
@@ -106,27 +112,54 @@ class Classification
     encoded_ = (encoded_ & ~mate_in_ply_mask) | (static_cast<encoded_type>(ply + 1) << mate_in_ply_shift);
   }
 
-  // Set in how many ply this position is mate.
-  [[nodiscard]] bool set_mate_in_ply(std::mutex& m, ply_type ply)
+  // Set in how many ply this position is mate, unless that was already set.
+  // Returns true if this call set it. This function is thread-safe.
+  [[nodiscard]] bool set_mate_in_ply_if_unknown(ply_type ply)
   {
-    std::lock_guard<std::mutex> const lock(m);
-
     // The bits corresponding to mate_in_ply_mask are initially all zero (meaning "unknown"; aka encoded_unknown_ply).
     // Those bits are changed once, by one thread, to something non-zero (iff the corresponding position is legal and not a is_draw),
     // and never changed again.
-    // The bits are only changed by this function.
     // There is a race condition between threads, where multiple threads can call this function concurrently.
     // In that case it doesn't matter which thread makes the change, because it is guaranteed that all pass the same value for `ply`.
     // However, only one of them is allowed to return true.
+    //
+    // The other bits are not changed while multiple threads access this object, hence only the ply bits can
+    // cause the compare-and-swap to fail; relaxed memory order suffices because the result is only read after
+    // all threads synchronized at the end of the current ply.
+    std::atomic_ref<encoded_type> encoded(encoded_);
+    encoded_type expected = encoded.load(std::memory_order_relaxed);
+    encoded_type const ply_bits = static_cast<encoded_type>(ply + 1) << mate_in_ply_shift;
+    for (;;)
+    {
+      if ((expected & mate_in_ply_mask) != encoded_unknown_ply)
+        return false;
+      if (encoded.compare_exchange_weak(expected, expected | ply_bits, std::memory_order_relaxed))
+        break;
+      SolverCounters::add(SolverCounters::cas_retries);
+    }
 
-    bool first = (encoded_ & mate_in_ply_mask) == encoded_unknown_ply;
-    if (!first)
-      return false;
-
-    set_mate_in_ply(ply);
+    // If it is a draw, then it isn't mate in `ply` moves; so why is this function being called?
+    ASSERT(!(expected & draw));
     return true;
   }
 
+  // Return a copy of this object that is read atomically; use this while other threads might call set_mate_in_ply_if_unknown.
+  Classification atomic_load() const
+  {
+    Classification result;
+    result.encoded_ = std::atomic_ref<encoded_type>(const_cast<encoded_type&>(encoded_)).load(std::memory_order_relaxed);
+    return result;
+  }
+
+  // Conversion from and to the raw representation (as stored in a Tablebase).
+  static Classification from_encoded(encoded_type encoded)
+  {
+    Classification result;
+    result.encoded_ = encoded;
+    return result;
+  }
+  encoded_type encoded() const { return encoded_; }
+
   // Accessors.
   encoded_type bits() const { return (encoded_ & bits_mask); }
   bool is_mate() const { return (encoded_ & mate); }
@@ -155,3 +188,5 @@ class Classification
 
 // Make sure that we have a zero-cost default constructor (and destructor).
 static_assert(std::is_trivial<Classification>::value, "Classification must be a trivial type for zero-cost abstractions.");
+
+} // namespace SIZE_NAMESPACE
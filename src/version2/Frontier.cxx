@@ -0,0 +1,60 @@
+#include "sys.h"
+#include "Frontier.h"
+#include <algorithm>
+#include "debug.h"
+
+inline namespace SIZE_NAMESPACE {
+
+size_t Frontier::size() const
+{
+  size_t count = 0;
+  for (Partition partition = PartitionIndex{size_t{0}}; partition != PartitionIndex{Partition::number_of_partitions}; ++partition)
+  {
+    if (!partition_used_[static_cast<PartitionIndex>(partition).get_value()])
+      continue;
+    word_type const* words = partition_words(partition);
+    for (size_t word_index = 0; word_index < words_per_partition; ++word_index)
+      count += std::popcount(words[word_index]);
+  }
+  return count;
+}
+
+std::vector<Partition> Frontier::used_partitions() const
+{
+  std::vector<Partition> partitions;
+  for (Partition partition = PartitionIndex{size_t{0}}; partition != PartitionIndex{Partition::number_of_partitions}; ++partition)
+    if (partition_used_[static_cast<PartitionIndex>(partition).get_value()])
+      partitions.push_back(partition);
+  return partitions;
+}
+
+Board Frontier::front() const
+{
+  for (Partition partition = PartitionIndex{size_t{0}}; partition != PartitionIndex{Partition::number_of_partitions}; ++partition)
+  {
+    if (!partition_used_[static_cast<PartitionIndex>(partition).get_value()])
+      continue;
+    word_type const* words = partition_words(partition);
+    for (size_t word_index = 0; word_index < words_per_partition; ++word_index)
+      if (words[word_index] != 0)
+        return {partition, PartitionElement{InfoIndex{word_index * bits_per_word + std::countr_zero(words[word_index])}}};
+  }
+  // Don't call front() on an empty Frontier.
+  ASSERT(false);
+  return {};
+}
+
+void Frontier::clear()
+{
+  for (Partition partition = PartitionIndex{size_t{0}}; partition != PartitionIndex{Partition::number_of_partitions}; ++partition)
+  {
+    uint8_t& used = partition_used_[static_cast<PartitionIndex>(partition).get_value()];
+    if (!used)
+      continue;
+    word_type* words = partition_words(partition);
+    std::fill(words, words + words_per_partition, word_type{0});
+    used = 0;
+  }
+}
+
+} // namespace SIZE_NAMESPACE
@@ -0,0 +1,225 @@
+#pragma once
+
+#include "Partition.h"
+#include "PartitionElement.h"
+#include "Board.h"
+#include "run_chunked.h"
+#include "utils/AIAlert.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+inline namespace SIZE_NAMESPACE {
+
+// A set of positions (all with the same color to move), stored as one bit per PartitionElement per Partition.
+//
+// This is used for the positions whose ply was just determined (the parents found while processing the
+// previous ply). Contrary to a std::vector<Board> the memory used does not depend on the number of positions
+// in the set, and running over the set visits the Info arrays in memory order (partition by partition).
+//
+// Each partition also has a flag that is set when at least one of its bits is set, so that running
+// over (or clearing) a sparse frontier only has to look at the partitions that are actually used.
+//
+// Inserting is thread-safe; iterating and clearing are not (and may not be done concurrently with inserting).
+class Frontier
+{
+ public:
+  using word_type = uint64_t;
+  static constexpr size_t bits_per_word = 8 * sizeof(word_type);
+  static constexpr size_t words_per_partition = (PartitionElement::number_of_elements + bits_per_word - 1) / bits_per_word;
+
+ private:
+  std::unique_ptr<word_type[]> bits_;                   // words_per_partition words per partition.
+  std::unique_ptr<uint8_t[]> partition_used_;           // Non-zero if any bit of the corresponding partition might be set.
+
+  static_assert(std::atomic_ref<word_type>::is_always_lock_free && std::atomic_ref<uint8_t>::is_always_lock_free,
+      "Frontier must be lock-free.");
+
+  word_type* partition_words(Partition partition) const
+  {
+    return &bits_[static_cast<PartitionIndex>(partition).get_value() * words_per_partition];
+  }
+
+ public:
+  Frontier() :
+    bits_(std::make_unique<word_type[]>(Partition::number_of_partitions * words_per_partition)),
+    partition_used_(std::make_unique<uint8_t[]>(Partition::number_of_partitions)) { }
+
+  // Add a canonical board to the set. This function is thread-safe.
+  void insert(Board board)
+  {
+    Partition const partition = board.as_partition();
+    size_t const bit_index = static_cast<InfoIndex>(board.as_partition_element()).get_value();
+    word_type const mask = word_type{1} << (bit_index % bits_per_word);
+    [[maybe_unused]] word_type const old_word =
+      std::atomic_ref<word_type>(partition_words(partition)[bit_index / bits_per_word]).fetch_or(mask, std::memory_order_relaxed);
+    // Every position is added at most once.
+    ASSERT(!(old_word & mask));
+    // Only write to the flag when it isn't set yet, to avoid all threads writing to the same cache line.
+    std::atomic_ref<uint8_t> used(partition_used_[static_cast<PartitionIndex>(partition).get_value()]);
+    if (!used.load(std::memory_order_relaxed))
+      used.store(1, std::memory_order_relaxed);
+  }
+
+  bool empty() const
+  {
+    for (size_t partition_index = 0; partition_index < Partition::number_of_partitions; ++partition_index)
+      if (partition_used_[partition_index])
+        return false;
+    return true;
+  }
+
+  // Returns the number of positions in the set.
+  size_t size() const;
+
+  // Returns the first position in the set (which may not be empty).
+  Board front() const;
+
+  // Remove all positions from the set.
+  void clear();
+
+  // Call `write(void const* data, size_t size)` with the contents of this set.
+  // For every used partition this writes a PartitionRecord followed by either the elements of that
+  // partition (as uint32_t, if that is smaller) or its words. The last record has partition_index
+  // set to Partition::number_of_partitions.
+  template<typename WRITE>
+  void serialize(WRITE const& write) const;
+
+  // Read back what was written by serialize, using `read(void* data, size_t size)`. This replaces the contents of this set.
+  template<typename READ>
+  void deserialize(READ const& read);
+
+  // Returns the partitions that contain at least one position, in increasing order.
+  std::vector<Partition> used_partitions() const;
+
+  // Call `body(task_n, Board)` for every position in the set using `number_of_tasks` tasks in parallel.
+  //
+  // The work is divided in chunks of consecutive words of the bitmap (see run_chunked),
+  // so that every task runs over the Info arrays in memory order.
+  template<typename BODY>
+  ChunkedRunTimes for_each(AIThreadPool& thread_pool, AIQueueHandle queue_handle, int number_of_tasks, BODY const& body) const
+  {
+    return for_each(thread_pool, queue_handle, number_of_tasks, used_partitions(), body);
+  }
+
+  // Same, but only for the positions that belong to one of `partitions`.
+  template<typename BODY>
+  ChunkedRunTimes for_each(AIThreadPool& thread_pool, AIQueueHandle queue_handle, int number_of_tasks,
+      std::vector<Partition> const& partitions, BODY const& body) const
+  {
+    return run_chunked(thread_pool, queue_handle, number_of_tasks, partitions.size() * words_per_partition, min_chunk_size,
+        [this, &partitions, &body](int task_n, size_t begin, size_t end){
+          while (begin < end)
+          {
+            Partition const partition = partitions[begin / words_per_partition];
+            size_t const word_begin = begin % words_per_partition;
+            size_t const word_end = std::min(words_per_partition, word_begin + (end - begin));
+            for_each(partition, word_begin, word_end, [task_n, &body](Board board){ body(task_n, board); });
+            begin += word_end - word_begin;
+          }
+        });
+  }
+
+  // Call `body(Board)` for every position in the set that belongs to `partition`.
+  template<typename BODY>
+  void for_each(Partition partition, BODY const& body) const
+  {
+    for_each(partition, 0, words_per_partition, body);
+  }
+
+ private:
+  struct PartitionRecord
+  {
+    uint32_t partition_index;
+    uint32_t number_of_positions;
+  };
+
+  static_assert(PartitionElement::number_of_elements <= 0x100000000, "Serialization stores a PartitionElement as uint32_t.");
+
+  // Returns true if a partition with `number_of_positions` positions is serialized as a list of elements.
+  static bool is_sparse(size_t number_of_positions)
+  {
+    return number_of_positions * sizeof(uint32_t) < words_per_partition * sizeof(word_type);
+  }
+
+  // The minimum number of words of the bitmap that a task processes at a time.
+  static constexpr size_t min_chunk_size = 4;
+
+  // Call `body(Board)` for every position that belongs to `partition` and is stored in the words [word_begin, word_end).
+  template<typename BODY>
+  void for_each(Partition partition, size_t word_begin, size_t word_end, BODY const& body) const
+  {
+    word_type const* words = partition_words(partition);
+    for (size_t word_index = word_begin; word_index < word_end; ++word_index)
+    {
+      // Run over the set bits of this word.
+      for (word_type word = words[word_index]; word != 0; word &= word - 1)
+      {
+        size_t const bit_index = word_index * bits_per_word + std::countr_zero(word);
+        body(Board{partition, PartitionElement{InfoIndex{bit_index}}});
+      }
+    }
+  }
+};
+
+template<typename WRITE>
+void Frontier::serialize(WRITE const& write) const
+{
+  for (Partition partition : used_partitions())
+  {
+    word_type const* words = partition_words(partition);
+    size_t number_of_positions = 0;
+    for (size_t word_index = 0; word_index < words_per_partition; ++word_index)
+      number_of_positions += std::popcount(words[word_index]);
+    PartitionRecord const record{static_cast<uint32_t>(static_cast<PartitionIndex>(partition).get_value()),
+      static_cast<uint32_t>(number_of_positions)};
+    write(&record, sizeof(record));
+    if (is_sparse(number_of_positions))
+      for_each(partition, [&write](Board board){
+        uint32_t const element = static_cast<InfoIndex>(board.as_partition_element()).get_value();
+        write(&element, sizeof(element));
+      });
+    else
+      write(words, words_per_partition * sizeof(word_type));
+  }
+  PartitionRecord const end_record{static_cast<uint32_t>(Partition::number_of_partitions), 0};
+  write(&end_record, sizeof(end_record));
+}
+
+template<typename READ>
+void Frontier::deserialize(READ const& read)
+{
+  std::fill(bits_.get(), bits_.get() + Partition::number_of_partitions * words_per_partition, word_type{0});
+  std::fill(partition_used_.get(), partition_used_.get() + Partition::number_of_partitions, uint8_t{0});
+  for (;;)
+  {
+    PartitionRecord record;
+    read(&record, sizeof(record));
+    if (record.partition_index == Partition::number_of_partitions)
+      break;
+    if (record.partition_index > Partition::number_of_partitions ||
+        record.number_of_positions > PartitionElement::number_of_elements ||
+        partition_used_[record.partition_index])
+      THROW_ALERT("Corrupt frontier: unexpected record for partition [INDEX].", AIArgs("[INDEX]", record.partition_index));
+    partition_used_[record.partition_index] = 1;
+    word_type* words = partition_words(PartitionIndex{size_t{record.partition_index}});
+    if (is_sparse(record.number_of_positions))
+    {
+      for (uint32_t n = 0; n < record.number_of_positions; ++n)
+      {
+        uint32_t element;
+        read(&element, sizeof(element));
+        if (element >= PartitionElement::number_of_elements)
+          THROW_ALERT("Corrupt frontier: element out of range.");
+        words[element / bits_per_word] |= word_type{1} << (element % bits_per_word);
+      }
+    }
+    else
+      read(words, words_per_partition * sizeof(word_type));
+  }
+}
+
+} // namespace SIZE_NAMESPACE
@@ -1,64 +1,297 @@
 #include "sys.h"
 #include "Graph.h"
 #include "Board.h"
+#include "run_tasks.h"
+#include "utils/AIAlert.h"
 #include "debug.h"
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
 #include <format>
+#include <type_traits>
+#include <sys/mman.h>
 
-void Graph::classify()
+inline namespace SIZE_NAMESPACE {
+
+void Graph::for_each_partition(AIThreadPool& thread_pool, AIQueueHandle queue_handle, int max_number_of_tasks,
+    std::function<void(Partition)> const& partition_body)
+{
+  // Every task processes whole partitions at a time, so that each task writes to its own part of the infos arrays.
+  std::atomic<size_t> next_partition = 0;
+  int const number_of_tasks = std::min(number_of_partitions, static_cast<size_t>(max_number_of_tasks));
+  run_tasks(thread_pool, queue_handle, number_of_tasks, [&next_partition, &partition_body](int /*task_n*/){
+    size_t partition_index;
+    while ((partition_index = next_partition++) < number_of_partitions)
+      partition_body(PartitionIndex{partition_index});
+  });
+}
+
+void Graph::classify(AIThreadPool& thread_pool, AIQueueHandle queue_handle, int max_number_of_tasks)
+{
+  for_each_partition(thread_pool, queue_handle, max_number_of_tasks, [this](Partition partition){ classify(partition); });
+}
+
+void Graph::classify(Partition partition)
 {
   // A dummy array.
   Board::neighbors_type neighbors;
-  // Generate all possible positions.
-  for (int bk_x = 0; bk_x < Size::board::x; ++bk_x)
+  Info::nodes_type const& nodes = (*black_to_move_infos_)[partition];
+  // Generate all possible positions of this partition.
+  for (PartitionElement partition_element = nodes.ibegin(); partition_element != nodes.iend(); ++partition_element)
   {
-    for (int bk_y = 0; bk_y < Size::board::y; ++bk_y)
+    Board const pos(partition, partition_element);
+
+    // Only canonical positions are stored.
+    if (!pos.is_canonical())
+      continue;
+
+    for (int color = 0; color < 2; ++color)
     {
-      for (int wk_x = 0; wk_x < Size::board::x; ++wk_x)
+      Color const to_move(static_cast<color_type>(color));
+
+      if (pos.determine_legal(to_move))
       {
-        for (int wk_y = 0; wk_y < Size::board::y; ++wk_y)
+        Info& info = (to_move == black) ? get_info<black>(partition, partition_element) : get_info<white>(partition, partition_element);
+        Classification& classification = info.classification();
+        ASSERT(!classification.is_legal());
+        classification.determine(pos, to_move);
+
+        if (!classification.is_draw())
         {
-          for (int wr_x = 0; wr_x < Size::board::x; ++wr_x)
-          {
-            for (int wr_y = 0; wr_y < Size::board::y; ++wr_y)
-            {
-              for (int color = 0; color < 2; ++color)
-              {
-                BlackKingSquare const black_king{bk_x, bk_y};
-                WhiteKingSquare const white_king{wk_x, wk_y};
-                WhiteRookSquare const white_rook{wr_x, wr_y};
-                Color const to_move(static_cast<color_type>(color));
-
-                Board const pos(black_king, white_king, white_rook);
-
-                if (pos.determine_legal(to_move))
-                {
-                  Info& info = (to_move == black) ? get_info<black>(pos) : get_info<white>(pos);
-                  Classification& classification = info.classification();
-                  ASSERT(!classification.is_legal());
-                  classification.determine(pos, to_move);
-
-                  if (!classification.is_draw())
-                  {
-                    if (to_move == black)
-                      info.set_number_of_children(pos.generate_neighbors<Board::children, black>(neighbors));
-                    else
-                      info.set_number_of_children(pos.generate_neighbors<Board::children, white>(neighbors));
-                  }
-                }
-              }
-            }
-          }
+          int const number_of_children = (to_move == black) ?
+            pos.generate_neighbors<Board::children, black>(neighbors) :
+            pos.generate_neighbors<Board::children, white>(neighbors);
+          // Children that are each other's mirror image are the same node.
+          info.set_number_of_children(Board::canonicalize_neighbors(neighbors, number_of_children));
         }
       }
     }
   }
 }
 
+namespace {
+
+// Set [start, start + size) to zero by giving the pages back to the kernel; they then read as zero.
+// MADV_DONTNEED does that for anonymous memory and MADV_REMOVE for a shared mapping of a file (it punches
+// a hole in the file, like fallocate(FALLOC_FL_PUNCH_HOLE)). If that isn't supported zeroes are written.
+void zero_pages(void* start, size_t size, bool anonymous)
+{
+  if (::madvise(start, size, anonymous ? MADV_DONTNEED : MADV_REMOVE) == 0)
+    return;
+  Dout(dc::notice, "madvise(" << (anonymous ? "MADV_DONTNEED" : "MADV_REMOVE") << ") failed: " << std::strerror(errno) << "; writing zeroes.");
+  std::memset(start, 0, size);
+}
+
+} // namespace
+
+void Graph::initialize()
+{
+  zero_pages(infos_pool_.mapped_base(), 2 * infos_size(), false);
+  zero_auxiliary_infos();
+}
+
+void Graph::zero_auxiliary_infos()
+{
+  zero_pages(auxiliary_infos_memory_.mapped_base(), auxiliary_infos_memory_.mapped_size(), auxiliary_infos_memory_.is_anonymous());
+}
+
+void Graph::reset_ply(AIThreadPool& thread_pool, AIQueueHandle queue_handle, int max_number_of_tasks)
+{
+  // AuxiliaryInfo::reset_ply sets everything to zero.
+  zero_auxiliary_infos();
+  for_each_partition(thread_pool, queue_handle, max_number_of_tasks, [this](Partition partition){ reset_ply(partition); });
+}
+
+void Graph::reset_ply(Partition partition)
+{
+  // Info::reset_ply clears some bits and leaves the rest alone; do that with a mask over whole words,
+  // so that the compiler can vectorize the loop. The mask is the result of reset_ply on an Info with all bits set.
+  // Setting and reading the bytes of an Info like that requires it to be trivially copyable.
+  typedef uint64_t __attribute__((may_alias)) word_type;
+  static_assert(sizeof(word_type) % sizeof(Info) == 0, "An Info may not straddle two words.");
+  static_assert(std::is_trivially_copyable_v<Info>, "The mask is applied byte-wise to the Info objects.");
+  static word_type const mask = []{
+    alignas(Info) unsigned char buffer[sizeof(word_type)];
+    std::memset(buffer, 0xff, sizeof(buffer));
+    Info* const infos = reinterpret_cast<Info*>(buffer);
+    for (size_t i = 0; i < sizeof(word_type) / sizeof(Info); ++i)
+      infos[i].reset_ply();
+    word_type mask;
+    std::memcpy(&mask, buffer, sizeof(mask));
+    return mask;
+  }();
+
+  for (infos_type* infos : { black_to_move_infos_.get(), white_to_move_infos_.get() })
+  {
+    Info* info = reinterpret_cast<Info*>(&(*infos)[partition]);
+    Info* const end = info + PartitionElement::number_of_elements;
+    // The Info before the first word boundary.
+    for (; info != end && reinterpret_cast<uintptr_t>(info) % sizeof(word_type) != 0; ++info)
+      info->reset_ply();
+    word_type* word = reinterpret_cast<word_type*>(info);
+    word_type* const last_word = word + (end - info) * sizeof(Info) / sizeof(word_type);
+    for (; word != last_word; ++word)
+      *word &= mask;
+    // The Info after the last word boundary.
+    for (info = reinterpret_cast<Info*>(last_word); info != end; ++info)
+      info->reset_ply();
+  }
+}
+
+void Graph::sync()
+{
+  if (::msync(infos_pool_.mapped_base(), 2 * infos_size(), MS_SYNC) == -1)
+    THROW_ALERTE("msync() failed");
+}
+
+void Graph::sync(color_type to_move, std::vector<Partition> const& partitions)
+{
+  infos_type& infos = to_move == black ? *black_to_move_infos_ : *white_to_move_infos_;
+  uintptr_t const page_mask = memory::MemoryMappedPool::memory_page_size() - 1;
+  // msync needs a page aligned address; round outwards and merge the ranges of adjacent partitions.
+  uintptr_t begin = 0;
+  uintptr_t end = 0;
+  auto flush = [&begin, &end](){
+    if (begin != end && ::msync(reinterpret_cast<void*>(begin), end - begin, MS_SYNC) == -1)
+      THROW_ALERTE("msync() failed");
+  };
+  for (Partition partition : partitions)
+  {
+    uintptr_t const partition_begin = reinterpret_cast<uintptr_t>(&infos[partition]) & ~page_mask;
+    uintptr_t const partition_end = (reinterpret_cast<uintptr_t>(&infos[partition]) + sizeof(Info::nodes_type) + page_mask) & ~page_mask;
+    if (partition_begin > end)
+    {
+      flush();
+      begin = partition_begin;
+    }
+    end = partition_end;
+  }
+  flush();
+}
+
+void Graph::advise(Partition partition, color_type to_move, bool auxiliary, Advice advice)
+{
+  uintptr_t begin;
+  uintptr_t end;
+  if (auxiliary)
+  {
+    auxiliary_infos_type& auxiliary_infos = to_move == black ? *black_to_move_auxiliary_infos_ : *white_to_move_auxiliary_infos_;
+    begin = reinterpret_cast<uintptr_t>(&auxiliary_infos[partition]);
+    end = begin + sizeof(AuxiliaryInfo::nodes_type);
+  }
+  else
+  {
+    infos_type& infos = to_move == black ? *black_to_move_infos_ : *white_to_move_infos_;
+    begin = reinterpret_cast<uintptr_t>(&infos[partition]);
+    end = begin + sizeof(Info::nodes_type);
+  }
+  // madvise needs page aligned addresses. Round outwards for will_need, but inwards for dont_need
+  // so that the pages that are shared with a neighboring partition are never dropped.
+  uintptr_t const page_mask = memory::MemoryMappedPool::memory_page_size() - 1;
+  if (advice == Advice::will_need)
+  {
+    begin &= ~page_mask;
+    end = (end + page_mask) & ~page_mask;
+  }
+  else
+  {
+    begin = (begin + page_mask) & ~page_mask;
+    end &= ~page_mask;
+  }
+  if (begin >= end)
+    return;
+  int behavior = advice == Advice::will_need ? MADV_WILLNEED : MADV_DONTNEED;
+  // MADV_DONTNEED zeroes anonymous memory. Only mark it as a candidate for swapping out instead.
+  if (auxiliary && auxiliary_infos_memory_.is_anonymous() && advice == Advice::dont_need)
+  {
+#ifdef MADV_COLD
+    behavior = MADV_COLD;
+#else
+    return;
+#endif
+  }
+  // This is only advice; ignore errors.
+  ::madvise(reinterpret_cast<void*>(begin), end - begin, behavior);
+}
+
+bool Graph::advise_huge_pages()
+{
+  // Both mappings are page aligned, so they can be passed as a whole; the kernel only uses huge pages
+  // for the parts that are huge page aligned.
+  return HugePages::advise(infos_pool_.mapped_base(), 2 * infos_size()) &&
+    HugePages::advise(auxiliary_infos_memory_.mapped_base(), auxiliary_infos_memory_.mapped_size());
+}
+
+HugePages::Coverage Graph::infos_huge_page_coverage()
+{
+  return HugePages::coverage(infos_pool_.mapped_base(), 2 * infos_size());
+}
+
+HugePages::Coverage Graph::auxiliary_infos_huge_page_coverage()
+{
+  return HugePages::coverage(auxiliary_infos_memory_.mapped_base(), auxiliary_infos_memory_.mapped_size());
+}
+
+void Graph::rollback_to_ply(AIThreadPool& thread_pool, AIQueueHandle queue_handle, int max_number_of_tasks, int ply)
+{
+  // All positions must have their ply rolled back before the children can be counted.
+  for_each_partition(thread_pool, queue_handle, max_number_of_tasks, [this, ply](Partition partition){ forget_ply_above(partition, ply); });
+  for_each_partition(thread_pool, queue_handle, max_number_of_tasks, [this, ply](Partition partition){ count_visited_children(partition, ply); });
+}
+
+void Graph::forget_ply_above(Partition partition, int ply)
+{
+  Info::nodes_type& black_to_move_nodes = (*black_to_move_infos_)[partition];
+  Info::nodes_type& white_to_move_nodes = (*white_to_move_infos_)[partition];
+  for (PartitionElement partition_element = black_to_move_nodes.ibegin();
+      partition_element != black_to_move_nodes.iend(); ++partition_element)
+  {
+    for (Info* info : { &black_to_move_nodes[partition_element], &white_to_move_nodes[partition_element] })
+      if (info->classification().ply() > ply)
+        info->reset_ply();
+  }
+}
+
+void Graph::count_visited_children(Partition partition, int ply)
+{
+  Board::neighbors_type children;
+  Info::nodes_type const& nodes = (*black_to_move_infos_)[partition];
+  for (PartitionElement partition_element = nodes.ibegin(); partition_element != nodes.iend(); ++partition_element)
+  {
+    auto [info, auxiliary_info] = get_info_tuple<black>(partition, partition_element);
+    auxiliary_info.initialize();
+    Classification const& classification = info.classification();
+    // Only black to move positions that can still be reached by a child need their visited children to be counted.
+    if (!classification.is_legal() || classification.is_draw() || classification.ply() != Classification::unknown_ply)
+      continue;
+    Board const pos(partition, partition_element);
+    int number_of_children = pos.generate_neighbors<Board::children, black>(children);
+    number_of_children = Board::canonicalize_neighbors(children, number_of_children);
+    // The white to move children that are mate in less than `ply` ply were processed before the checkpoint was made
+    // (if the frontier has white to move then the children that are mate in `ply` ply are processed after resuming).
+    Info::degree_type number_of_visited_children = 0;
+    for (int i = 0; i < number_of_children; ++i)
+    {
+      int const child_ply = get_info<white>(children[i]).classification().ply();
+      if (child_ply != Classification::unknown_ply && child_ply < ply)
+        ++number_of_visited_children;
+    }
+    auxiliary_info.set_number_of_visited_children(number_of_visited_children);
+  }
+}
+
 //static
 std::filesystem::path Graph::data_directory(std::filesystem::path const& prefix_directory)
 {
+  // The folded layout (see Partition.h) is not compatible with the unfolded one,
+  // the dense PartitionElement not with the bit packed one unless they are the same,
+  // and the Z-order of the squares of a block (see BlockSquareOrder) not with the row by row order.
   return prefix_directory /
          std::format("board{}x{}", Size::board_size_x, Size::board_size_y) /
-         std::format("partition{}x{}", Size::Px, Size::Py);
+         std::format("partition{}x{}{}{}", Size::Px, Size::Py, Size::diagonal_symmetry ? "_folded" : "",
+             PartitionElement::same_as_bit_packed ? "" : BlockSquareOrder::morton ? "_morton" : "_dense");
 }
+
+} // namespace SIZE_NAMESPACE
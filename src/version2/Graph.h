@@ -4,18 +4,23 @@
 #include "PartitionElement.h"
 #include "Info.h"
 #include "Board.h"
+#include "HugePages.h"
+#include "ScratchMemory.h"
 #include "memory/MemoryMappedPool.h"
+#include "threadpool/AIThreadPool.h"
 #include "utils/Array.h"
 #include "utils/nearest_multiple_of_power_of_two.h"
 #include "utils/square.h"
 #include <filesystem>
 #include <tuple>
+#include <vector>
+
+inline namespace SIZE_NAMESPACE {
 
 class Graph
 {
  public:
-  static constexpr size_t number_of_partitions = utils::square(Size::Px * Size::Py);
-  static constexpr size_t number_of_mutexes = 131072;
+  static constexpr size_t number_of_partitions = Partition::number_of_partitions;
   using infos_type = utils::Array<Info::nodes_type, number_of_partitions, PartitionIndex>;
   using auxiliary_infos_type = utils::Array<AuxiliaryInfo::nodes_type, number_of_partitions, PartitionIndex>;
   using black_to_move_infos_type = std::unique_ptr<infos_type, std::function<void(infos_type*)>>;
@@ -24,15 +29,13 @@ class Graph
   using white_to_move_auxiliary_infos_type = std::unique_ptr<auxiliary_infos_type, std::function<void(auxiliary_infos_type*)>>;
 
  private:
-  std::filesystem::path data_directory_;
   memory::MemoryMappedPool infos_pool_;
-  memory::MemoryMappedPool auxiliary_infos_pool_;
+  ScratchMemory auxiliary_infos_memory_;
   bool reuse_file_;
   black_to_move_infos_type black_to_move_infos_;
   black_to_move_auxiliary_infos_type black_to_move_auxiliary_infos_;
   white_to_move_infos_type white_to_move_infos_;
   white_to_move_auxiliary_infos_type white_to_move_auxiliary_infos_;
-  std::vector<std::mutex> mutexes_;
 
   // The space allocated for an `infos_type` array.
   // This is also the offset (in the memory mapped file) between the black_to_move_infos_ and the white_to_move_infos_ array.
@@ -57,10 +60,6 @@ class Graph
       void* white_to_move_infos_pool = infos_pool_.allocate();
       ASSERT(white_to_move_infos_pool != nullptr && white_to_move_infos_pool == white_to_move_infos_start());
     }
-    void* black_to_move_auxiliary_infos_pool = auxiliary_infos_pool_.allocate();
-    ASSERT(black_to_move_auxiliary_infos_pool != nullptr && black_to_move_auxiliary_infos_pool == black_to_move_auxiliary_infos_start());
-    void* white_to_move_auxiliary_infos_pool = auxiliary_infos_pool_.allocate();
-    ASSERT(white_to_move_auxiliary_infos_pool != nullptr && white_to_move_auxiliary_infos_pool == white_to_move_auxiliary_infos_start());
   }
 
   void* black_to_move_infos_start()
@@ -75,23 +74,22 @@ class Graph
 
   void* black_to_move_auxiliary_infos_start()
   {
-    return auxiliary_infos_pool_.mapped_base();
+    return auxiliary_infos_memory_.mapped_base();
   }
 
   void* white_to_move_auxiliary_infos_start()
   {
-    return static_cast<char*>(auxiliary_infos_pool_.mapped_base()) + auxiliary_infos_size();
+    return static_cast<char*>(auxiliary_infos_memory_.mapped_base()) + auxiliary_infos_size();
   }
 
  public:
-  Graph(std::filesystem::path prefix_directory, bool reuse_file, bool read_only = false) :
-    data_directory_(data_directory(prefix_directory)),
+  // The AuxiliaryInfo is only needed while solving and is kept in anonymous memory, unless
+  // auxiliary_infos_budget is non-zero and it needs more than that (see ScratchMemory).
+  Graph(std::filesystem::path prefix_directory, bool reuse_file, bool read_only = false, size_t auxiliary_infos_budget = 0) :
     infos_pool_(data_filename(prefix_directory), infos_size(), 2 * infos_size(),
-        read_only ? memory::MemoryMappedPool::Mode::copy_on_write : memory::MemoryMappedPool::Mode::persistent, !reuse_file),
-    auxiliary_infos_pool_(tmp_data_filename(prefix_directory), auxiliary_infos_size(), 2 * auxiliary_infos_size(),
-        memory::MemoryMappedPool::Mode::persistent, true),
-    reuse_file_(reuse_file),
-    mutexes_(number_of_mutexes)
+        read_only ? memory::MemoryMappedPool::Mode::copy_on_write : memory::MemoryMappedPool::Mode::persistent, false),
+    auxiliary_infos_memory_(2 * auxiliary_infos_size(), auxiliary_infos_budget, tmp_data_filename(prefix_directory)),
+    reuse_file_(reuse_file)
     {
       do_allocate();
       black_to_move_infos_ = black_to_move_infos_type(
@@ -102,55 +100,80 @@ class Graph
           new (white_to_move_infos_start()) infos_type, [this](infos_type* ptr){ });
       white_to_move_auxiliary_infos_ = white_to_move_auxiliary_infos_type(
           new (white_to_move_auxiliary_infos_start()) auxiliary_infos_type, [this](auxiliary_infos_type* ptr){ });
+      // A new file is sparse, so this doesn't write anything.
+      if (!reuse_file)
+        initialize();
     }
 
-  ~Graph()
-  {
-    DoutEntering(dc::notice, "Graph::~Graph()");
-    std::filesystem::path tmp_data = data_directory_ / "tmp_data.img";
-    Dout(dc::notice, "Removing " << tmp_data);
-    std::filesystem::remove(tmp_data);
-  }
+  // Set every Info and AuxiliaryInfo to zero (see Info::initialize and AuxiliaryInfo::initialize).
+  // The pages are given back to the kernel (they then read as zero) instead of being written.
+  void initialize();
 
-  void initialize()
-  {
-    // This sets everything to zero.
-    for (Info::nodes_type& nodes : *black_to_move_infos_)
-      for (Info& info : nodes)
-        info.initialize();
-    for (AuxiliaryInfo::nodes_type& nodes : *black_to_move_auxiliary_infos_)
-      for (AuxiliaryInfo& auxiliary_info : nodes)
-        auxiliary_info.initialize();
-    for (Info::nodes_type& nodes : *white_to_move_infos_)
-      for (Info& info : nodes)
-        info.initialize();
-    for (AuxiliaryInfo::nodes_type& nodes : *white_to_move_auxiliary_infos_)
-      for (AuxiliaryInfo& auxiliary_info : nodes)
-        auxiliary_info.initialize();
-  }
+  // Set everything that is required to recalculate the ply to zero (see Info::reset_ply and AuxiliaryInfo::reset_ply),
+  // using up to max_number_of_tasks tasks in parallel.
+  void reset_ply(AIThreadPool& thread_pool, AIQueueHandle queue_handle, int max_number_of_tasks);
+
+  // Determine the Classification and number of children of every position, using up to max_number_of_tasks tasks in parallel.
+  void classify(AIThreadPool& thread_pool, AIQueueHandle queue_handle, int max_number_of_tasks);
+
+  // Write all changes to the memory mapped Info to disk.
+  void sync();
 
-  void reset_ply()
+  // Same, but only for the Info of `partitions` (in increasing order) with `to_move` to move.
+  // This is cheaper than syncing everything when only a few partitions changed.
+  void sync(color_type to_move, std::vector<Partition> const& partitions);
+
+  enum class Advice
   {
-    // This sets everything required to recalculate the ply to zero.
-    for (Info::nodes_type& nodes : *black_to_move_infos_)
-      for (Info& info : nodes)
-        info.reset_ply();
-    for (AuxiliaryInfo::nodes_type& nodes : *black_to_move_auxiliary_infos_)
-      for (AuxiliaryInfo& auxiliary_info : nodes)
-        auxiliary_info.reset_ply();
-    for (Info::nodes_type& nodes : *white_to_move_infos_)
-      for (Info& info : nodes)
-        info.reset_ply();
-    for (AuxiliaryInfo::nodes_type& nodes : *white_to_move_auxiliary_infos_)
-      for (AuxiliaryInfo& auxiliary_info : nodes)
-        auxiliary_info.reset_ply();
-  }
+    will_need,          // The data will be accessed soon: start reading it into memory.
+    dont_need           // The data won't be accessed for a while: it may be removed from memory.
+  };
+
+  // Advise the kernel about the Info (or, if `auxiliary` is set, the AuxiliaryInfo) of `partition` with `to_move` to move.
+  void advise(Partition partition, color_type to_move, bool auxiliary, Advice advice);
+
+  // Ask the kernel to map the Info and AuxiliaryInfo arrays with huge pages (see HugePages.h).
+  // Returns false if it doesn't support that; nothing changes then.
+  bool advise_huge_pages();
+
+  // Returns how much of the resident Info, respectively AuxiliaryInfo, arrays is mapped with huge pages.
+  HugePages::Coverage infos_huge_page_coverage();
+  HugePages::Coverage auxiliary_infos_huge_page_coverage();
+
+  // Returns the number of bytes used for the AuxiliaryInfo.
+  size_t auxiliary_infos_bytes() const { return auxiliary_infos_memory_.mapped_size(); }
+
+  // Prepare resuming the retrograde analysis with (a frontier of) positions that are mate in `ply` ply.
+  //
+  // Forgets the ply of all positions that are mate in more than `ply` ply (those were set by an interrupted ply)
+  // and recalculates the number of visited children (the AuxiliaryInfo is not stored) from the ply of the children.
+  void rollback_to_ply(AIThreadPool& thread_pool, AIQueueHandle queue_handle, int max_number_of_tasks, int ply);
 
-  void classify();
+ private:
+  // Call `partition_body(Partition)` for every partition, using up to max_number_of_tasks tasks in parallel.
+  void for_each_partition(AIThreadPool& thread_pool, AIQueueHandle queue_handle, int max_number_of_tasks,
+      std::function<void(Partition)> const& partition_body);
+
+  // Classify all positions of a single partition.
+  void classify(Partition partition);
+
+  // The two steps of rollback_to_ply for a single partition.
+  void forget_ply_above(Partition partition, int ply);
+  void count_visited_children(Partition partition, int ply);
+
+  // Reset the ply of all Info of a single partition.
+  void reset_ply(Partition partition);
+
+  // Set all AuxiliaryInfo to zero.
+  void zero_auxiliary_infos();
+
+ public:
 
   template<color_type to_move>
   Info& get_info(Board board)
   {
+    // Only canonical boards are stored; the mirror image of a board has the same Info.
+    board = board.canonical();
     infos_type& infos = to_move == black ? *black_to_move_infos_ : *white_to_move_infos_;
     return infos[board.as_partition()][board.as_partition_element()];
   }
@@ -158,6 +181,7 @@ class Graph
   template<color_type to_move>
   std::tuple<Info&, AuxiliaryInfo&> get_info_tuple(Board board)
   {
+    board = board.canonical();
     infos_type& infos =
       to_move == black ? *black_to_move_infos_            : *white_to_move_infos_;
     auxiliary_infos_type& auxiliary_infos =
@@ -170,6 +194,7 @@ class Graph
   template<color_type to_move>
   Info const& get_info(Board board) const
   {
+    board = board.canonical();
     infos_type const& infos = to_move == black ? *black_to_move_infos_ : *white_to_move_infos_;
     return infos[board.as_partition()][board.as_partition_element()];
   }
@@ -177,6 +202,7 @@ class Graph
   template<color_type to_move>
   std::tuple<Info const&, AuxiliaryInfo const&> get_info_tuple(Board board) const
   {
+    board = board.canonical();
     infos_type const& infos =
       to_move == black ? *black_to_move_infos_            : *white_to_move_infos_;
     auxiliary_infos_type const& auxiliary_infos =
@@ -200,9 +226,16 @@ class Graph
     return infos[partition][partition_element];
   }
 
-  std::mutex& get_mutex(Board board)
+  template<color_type to_move>
+  std::tuple<Info&, AuxiliaryInfo&> get_info_tuple(Partition partition, PartitionElement partition_element)
   {
-    return mutexes_[board.get_encoded() % number_of_mutexes];
+    infos_type& infos =
+      to_move == black ? *black_to_move_infos_            : *white_to_move_infos_;
+    auxiliary_infos_type& auxiliary_infos =
+      to_move == black ? *black_to_move_auxiliary_infos_ : *white_to_move_auxiliary_infos_;
+
+    return {     infos[partition][partition_element],
+      auxiliary_infos[partition][partition_element] };
   }
 
   // Returns a memory-mapped array (whose index is a PartitionIndex) that contains
@@ -212,6 +245,9 @@ class Graph
   // to find the Info object, the other way is not possible. When running over all
   // InfoIndexes one has to take into account that those include illegal Board's.
   // If the corresponding Board is illegal then the returned Info object is invalid.
+  // Likewise, if Size::diagonal_symmetry is set then only canonical boards are used;
+  // the Info of a non-canonical board (in a partition that is its own mirror image)
+  // remains zero (illegal).
   infos_type const& black_to_move_infos() const
   {
     return *black_to_move_infos_;
@@ -228,8 +264,11 @@ class Graph
   {
     return Graph::data_directory(prefix_directory) / "mmap.img";
   }
+  // The file that the AuxiliaryInfo is spilled to when it exceeds its budget.
   static std::filesystem::path tmp_data_filename(std::filesystem::path const& prefix_directory)
   {
     return Graph::data_directory(prefix_directory) / "tmp_data.img";
   }
 };
+
+} // namespace SIZE_NAMESPACE
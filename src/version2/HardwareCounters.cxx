@@ -0,0 +1,161 @@
+#include "sys.h"
+#include "HardwareCounters.h"
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "debug.h"
+
+namespace {
+
+// Returns the perf_event_attr of `counter`.
+perf_event_attr attributes(HardwareCounters::counter_type counter)
+{
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  constexpr uint64_t dtlb_read = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8);
+  switch (counter)
+  {
+    case HardwareCounters::cache_references:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CACHE_REFERENCES;
+      break;
+    case HardwareCounters::cache_misses:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CACHE_MISSES;
+      break;
+    case HardwareCounters::dtlb_loads:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = dtlb_read | (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
+      break;
+    case HardwareCounters::dtlb_load_misses:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = dtlb_read | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      break;
+    case HardwareCounters::number_of_counters:
+      ASSERT(false);
+  }
+  return attr;
+}
+
+} // namespace
+
+//static
+char const* HardwareCounters::name(counter_type counter)
+{
+  switch (counter)
+  {
+    case cache_references:
+      return "cache_references";
+    case cache_misses:
+      return "cache_misses";
+    case dtlb_loads:
+      return "dtlb_loads";
+    case dtlb_load_misses:
+      return "dtlb_load_misses";
+    case number_of_counters:
+      break;
+  }
+  ASSERT(false);
+  return "unknown";
+}
+
+HardwareCounters::HardwareCounters()
+{
+  std::vector<pid_t> threads;
+  for (auto const& entry : std::filesystem::directory_iterator("/proc/self/task"))
+    threads.push_back(std::stoi(entry.path().filename().string()));
+
+  for (int first = 0; first < number_of_counters; first += counters_per_group)
+  {
+    bool failed = false;
+    for (pid_t thread : threads)
+    {
+      int group_fd = -1;
+      for (int counter = first; counter < first + counters_per_group && !failed; ++counter)
+      {
+        perf_event_attr attr = attributes(static_cast<counter_type>(counter));
+        // Reading the leader returns the values of the whole group, plus the times needed to scale them.
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        int const fd = ::syscall(SYS_perf_event_open, &attr, thread, -1, group_fd, 0);
+        if (fd == -1)
+        {
+          Dout(dc::notice, "perf_event_open(" << name(static_cast<counter_type>(counter)) << ") failed: " << std::strerror(errno));
+          failed = true;
+          break;
+        }
+        if (group_fd == -1)
+          group_fd = fd;
+        fds_[counter].push_back(fd);
+      }
+      if (failed)
+        break;
+    }
+    // Either all counters of a group are available for every thread, or none.
+    if (failed)
+      for (int counter = first; counter < first + counters_per_group; ++counter)
+      {
+        for (int fd : fds_[counter])
+          ::close(fd);
+        fds_[counter].clear();
+      }
+  }
+}
+
+HardwareCounters::~HardwareCounters()
+{
+  for (std::vector<int> const& fds : fds_)
+    for (int fd : fds)
+      ::close(fd);
+}
+
+HardwareCounters::Sample HardwareCounters::read() const
+{
+  // The layout of what read() returns for PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING.
+  struct GroupReadFormat
+  {
+    uint64_t nr;
+    uint64_t time_enabled;
+    uint64_t time_running;
+    uint64_t values[counters_per_group];
+  };
+
+  Sample sample;
+  for (int group = 0; group < number_of_groups; ++group)
+    for (int fd : fds_[group * counters_per_group])
+    {
+      GroupReadFormat group_read;
+      if (::read(fd, &group_read, sizeof(group_read)) != sizeof(group_read) || group_read.nr != counters_per_group)
+        continue;
+      sample.time_enabled[group] += group_read.time_enabled;
+      sample.time_running[group] += group_read.time_running;
+      for (int i = 0; i < counters_per_group; ++i)
+        sample.values[group * counters_per_group + i] += group_read.values[i];
+    }
+  return sample;
+}
+
+//static
+HardwareCounters::values_type HardwareCounters::elapsed(Sample const& start, Sample const& end)
+{
+  values_type values{};
+  for (int group = 0; group < number_of_groups; ++group)
+  {
+    uint64_t const time_enabled = end.time_enabled[group] - start.time_enabled[group];
+    uint64_t const time_running = end.time_running[group] - start.time_running[group];
+    if (time_running == 0)
+      continue;
+    // Both counters of a group were counted during the same time_running, so their ratio doesn't need scaling;
+    // the scaling extrapolates the counts to the whole interval if the PMU was shared with other events.
+    double const scale = static_cast<double>(time_enabled) / time_running;
+    for (int counter = group * counters_per_group; counter < (group + 1) * counters_per_group; ++counter)
+      values[counter] = static_cast<uint64_t>((end.values[counter] - start.values[counter]) * scale + 0.5);
+  }
+  return values;
+}
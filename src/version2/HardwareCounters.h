@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Hardware performance counters of all threads of the process (see PlyMetrics.h).
+//
+// The counters are opened (with perf_event_open) for every thread that exists when the object is constructed,
+// so construct it after the thread pool. Only user space is counted.
+//
+// The counters come in pairs (references and misses, loads and load misses) that are opened as one group, with
+// the first of the pair as leader, so that the kernel always counts both over the same time. If the PMU has to
+// multiplex the groups then each count is scaled by the time that its group was enabled over the time that it
+// actually counted; the ratio of the two counters of a pair is exact either way. A pair that can't be opened
+// for every thread (no PMU, for example in a virtual machine, or a too strict /proc/sys/kernel/perf_event_paranoid)
+// is not available; the other pair still can be.
+class HardwareCounters
+{
+ public:
+  // The leader of each group must be even and be followed by the other counter of its group.
+  enum counter_type
+  {
+    cache_references,           // Accesses of the last level cache.
+    cache_misses,               // Misses of the last level cache.
+    dtlb_loads,                 // Loads that looked up the data TLB.
+    dtlb_load_misses,           // Loads that missed the data TLB.
+    number_of_counters
+  };
+  static constexpr int counters_per_group = 2;
+  static constexpr int number_of_groups = number_of_counters / counters_per_group;
+
+  using values_type = std::array<uint64_t, number_of_counters>;
+
+  // The raw counts, summed over all threads, and the time that each group was enabled and actually counting.
+  struct Sample
+  {
+    values_type values{};
+    std::array<uint64_t, number_of_groups> time_enabled{};
+    std::array<uint64_t, number_of_groups> time_running{};
+  };
+
+  static char const* name(counter_type counter);
+
+ private:
+  std::array<std::vector<int>, number_of_counters> fds_;        // The file descriptors of each counter, one per thread.
+
+  static counter_type leader(counter_type counter) { return static_cast<counter_type>(counter - counter % counters_per_group); }
+
+ public:
+  HardwareCounters();
+  ~HardwareCounters();
+
+  HardwareCounters(HardwareCounters const&) = delete;
+  HardwareCounters& operator=(HardwareCounters const&) = delete;
+
+  // Returns true if `counter` is counted.
+  bool available(counter_type counter) const { return !fds_[leader(counter)].empty(); }
+
+  // Returns the current counts (zero if a counter isn't available).
+  Sample read() const;
+
+  // Returns the counts between `start` and `end`, scaled by the time that their group was enabled over the time
+  // that it counted (zero if the group didn't count at all).
+  static values_type elapsed(Sample const& start, Sample const& end);
+};
@@ -0,0 +1,83 @@
+#include "sys.h"
+#include "HugePages.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <sys/mman.h>
+#include "debug.h"
+
+//static
+std::string HugePages::mode(char const* which)
+{
+  // The file contains all modes, with the selected one between square brackets: "always [madvise] never".
+  std::ifstream file(std::string("/sys/kernel/mm/transparent_hugepage/") + which);
+  std::string modes;
+  if (!std::getline(file, modes))
+    return {};
+  auto const begin = modes.find('[');
+  auto const end = modes.find(']', begin);
+  if (begin == std::string::npos || end == std::string::npos)
+    return {};
+  return modes.substr(begin + 1, end - begin - 1);
+}
+
+//static
+size_t HugePages::page_size()
+{
+  std::ifstream file("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size");
+  size_t size;
+  if (!(file >> size) || size == 0)
+    size = 2 * 1024 * 1024;
+  return size;
+}
+
+//static
+bool HugePages::advise(void* start, size_t size)
+{
+#ifdef MADV_HUGEPAGE
+  if (::madvise(start, size, MADV_HUGEPAGE) == 0)
+    return true;
+  // EINVAL: the kernel was compiled without transparent huge pages.
+  Dout(dc::notice, "madvise(MADV_HUGEPAGE) failed: " << std::strerror(errno));
+#endif
+  return false;
+}
+
+//static
+HugePages::Coverage HugePages::coverage(void const* start, size_t size)
+{
+  uintptr_t const begin = reinterpret_cast<uintptr_t>(start);
+  uintptr_t const end = begin + size;
+  Coverage coverage;
+  std::ifstream smaps("/proc/self/smaps");
+  bool in_range = false;
+  std::string line;
+  while (std::getline(smaps, line))
+  {
+    // Every mapping starts with a line "<begin>-<end> <perms> ...", followed by lines "<Field>: <value> kB".
+    unsigned long vma_begin, vma_end;
+    if (std::sscanf(line.c_str(), "%lx-%lx ", &vma_begin, &vma_end) == 2)
+    {
+      // Madvise and faults can split the mapping of a MemoryMappedPool into several VMAs; they all lie in the range.
+      in_range = vma_begin < end && begin < vma_end;
+      continue;
+    }
+    if (!in_range)
+      continue;
+    std::string_view const field(line);
+    auto const colon = field.find(':');
+    if (colon == std::string_view::npos)
+      continue;
+    std::string_view const name = field.substr(0, colon);
+    size_t const bytes = std::strtoul(line.c_str() + colon + 1, nullptr, 10) * 1024;
+    if (name == "Rss")
+      coverage.resident += bytes;
+    else if (name == "AnonHugePages" || name == "ShmemPmdMapped" || name == "FilePmdMapped")
+      coverage.huge += bytes;
+  }
+  return coverage;
+}
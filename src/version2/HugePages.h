@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Transparent huge page support for the memory mapped arrays of the Graph (see infchess2 --huge-pages).
+//
+// The Info and AuxiliaryInfo arrays are accessed all over the place while generating parents, so with
+// 4 kB pages nearly every access is a TLB miss. Mapping them with 2 MB pages fixes that, but it is up
+// to the kernel whether it does: anonymous memory and tmpfs/shmem files (mounted with huge=advise or
+// huge=within_size) can get huge pages, a file on a regular file system normally can't. Therefore
+// the huge pages are only requested, and the achieved coverage is measured afterwards.
+class HugePages
+{
+ public:
+  // How much of a memory range is resident, and how much of that is mapped with huge pages.
+  struct Coverage
+  {
+    size_t resident = 0;        // Bytes.
+    size_t huge = 0;            // Bytes.
+
+    double fraction() const { return resident == 0 ? 0.0 : static_cast<double>(huge) / resident; }
+    Coverage& operator+=(Coverage const& coverage) { resident += coverage.resident; huge += coverage.huge; return *this; }
+  };
+
+  // Returns the selected mode of /sys/kernel/mm/transparent_hugepage/`which` (for example "madvise"),
+  // or an empty string if the kernel doesn't support transparent huge pages.
+  static std::string mode(char const* which = "enabled");
+
+  // Returns the size of a huge page (PMD) in bytes.
+  static size_t page_size();
+
+  // Ask the kernel to back [start, start + size) with huge pages (madvise(MADV_HUGEPAGE)).
+  // Returns false if that isn't supported; the range is then left as it was.
+  static bool advise(void* start, size_t size);
+
+  // Returns the coverage of [start, start + size), read from /proc/self/smaps.
+  static Coverage coverage(void const* start, size_t size);
+};
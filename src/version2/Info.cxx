@@ -1,10 +1,15 @@
 #include "sys.h"
 #include "Info.h"
 #include "Graph.h"
+#include "Frontier.h"
+#include "SolverCounters.h"
 #include "utils/endian.h"
+#include <array>
 #include "debug.h"
 
-void Info::black_to_move_set_maximum_ply_on_parents(Board const current_board, Graph& graph, std::vector<Board>& parents_out)
+inline namespace SIZE_NAMESPACE {
+
+void Info::black_to_move_set_maximum_ply_on_parents(Board const current_board, Graph& graph, Frontier& parents_out)
 {
   //DoutEntering(dc::notice, "Info::black_to_move_set_maximum_ply_on_parents(" << current_board << ", graph, parents_out)");
 
@@ -19,33 +24,50 @@ void Info::black_to_move_set_maximum_ply_on_parents(Board const current_board, G
   // Generate all parent positions.
   Board::neighbors_type parents;
   int number_of_parents = current_board.generate_neighbors<Board::parents, white>(parents);
+  // Parents that are each other's mirror image are the same node.
+  number_of_parents = Board::canonicalize_neighbors(parents, number_of_parents);
+  SolverCounters::add(SolverCounters::parents_generated, number_of_parents);
+  // Look up the Info of all parents first and prefetch them, so that the cache misses overlap instead of stalling one by one.
+  std::array<Info*, Board::max_degree> parent_infos;
+  for (int i = 0; i < number_of_parents; ++i)
+  {
+    parent_infos[i] = &graph.get_info<white>(parents[i]);
+    __builtin_prefetch(parent_infos[i], 1);
+  }
   // Run over all parent positions.
   for (int i = 0; i < number_of_parents; ++i)
   {
     Board const& parent = parents[i];
-    auto [parent_info, parent_auxiliary_info] = graph.get_info_tuple<white>(parent);
-    // All returned parent positions should be legal.
-    ASSERT(parent_info.classification().is_legal());
-    int parent_ply = parent_info.classification().ply();
-    std::mutex& m = graph.get_mutex(parent);
-    // If this parent didn't have its number of ply determined yet, it must be mate in `max_ply`, see above.
-    if (parent_ply == Classification::unknown_ply &&            // Mostly a speed up to short-circuit parents with a lower number of ply.
-        parent_info.classification().set_mate_in_ply(m, max_ply))  // This fails if ply was already set.
+    if (parent_infos[i]->white_to_move_parent_reached(max_ply))
     {
       //Dout(dc::notice, "Adding parent " << parent);
-      parents_out.push_back(parent);
-    }
-    else
-    {
-      // We `set_mate_in_ply` for incremental ply, starting with 0.
-      // Therefore it can't happen that a parent_ply that is larger than max_ply is already set.
-      ASSERT(parent_ply <= max_ply);
+      parents_out.insert(parent);
     }
   }
 }
 
+bool Info::white_to_move_parent_reached(Classification::ply_type max_ply)
+{
+  // Other threads might be setting the ply of this parent concurrently.
+  Classification const parent_classification = classification_.atomic_load();
+  // All returned parent positions should be legal.
+  ASSERT(parent_classification.is_legal());
+  int parent_ply = parent_classification.ply();
+  // If this parent didn't have its number of ply determined yet, it must be mate in `max_ply`, see black_to_move_set_maximum_ply_on_parents.
+  if (parent_ply == Classification::unknown_ply &&            // Mostly a speed up to short-circuit parents with a lower number of ply.
+      classification_.set_mate_in_ply_if_unknown(max_ply))    // This fails if ply was already set.
+  {
+    SolverCounters::add(SolverCounters::parents_accepted);
+    return true;
+  }
+  // We `set_mate_in_ply` for incremental ply, starting with 0.
+  // Therefore it can't happen that a parent_ply that is larger than max_ply is already set.
+  ASSERT(parent_ply <= max_ply);
+  return false;
+}
+
 void Info::white_to_move_set_minimum_ply_on_parents(
-    Board const current_board, Graph& graph, std::vector<Board>& parents_out)
+    Board const current_board, Graph& graph, Frontier& parents_out)
 {
   //DoutEntering(dc::notice, "Info::white_to_move_set_minimum_ply_on_parents(" << current_board << ", graph, parents_out)");
 
@@ -60,39 +82,65 @@ void Info::white_to_move_set_minimum_ply_on_parents(
   // Generate all parent positions.
   Board::neighbors_type parents;
   int number_of_parents = current_board.generate_neighbors<Board::parents, black>(parents);
+  // Parents that are each other's mirror image are the same node; each must be counted only once.
+  number_of_parents = Board::canonicalize_neighbors(parents, number_of_parents);
+  SolverCounters::add(SolverCounters::parents_generated, number_of_parents);
   //Dout(dc::notice, "number_of_parents = " << number_of_parents);
+  // Look up (and prefetch) the Info and AuxiliaryInfo of all parents first, see black_to_move_set_maximum_ply_on_parents.
+  std::array<Info*, Board::max_degree> parent_infos;
+  std::array<AuxiliaryInfo*, Board::max_degree> parent_auxiliary_infos;
+  for (int i = 0; i < number_of_parents; ++i)
+  {
+    auto [parent_info, parent_auxiliary_info] = graph.get_info_tuple<black>(parents[i]);
+    parent_infos[i] = &parent_info;
+    parent_auxiliary_infos[i] = &parent_auxiliary_info;
+    __builtin_prefetch(parent_infos[i], 1);
+    __builtin_prefetch(parent_auxiliary_infos[i], 1);
+  }
   // Run over all parent positions.
   for (int i = 0; i < number_of_parents; ++i)
   {
     Board const& parent = parents[i];
     //Dout(dc::notice, "  parent " << i << " = " << parent);
-    auto [parent_info, parent_auxiliary_info] = graph.get_info_tuple<black>(parent);
-    //Dout(dc::notice, "    with info: " << parent_info);
-    // All returned parent positions should be legal.
-    ASSERT(parent_info.classification().is_legal());
-
-    // If black already has a draw in this (parent) position then it will never do the move that ends up as the current position.
-    if (parent_info.classification().is_draw())
-      continue;
-
-    // Call white_to_move_set_minimum_ply_on_parents exactly once for each position (where white is to move).
-    // In that case, the mate_in_ply_ member is only set after the last child called white_to_move_set_minimum_ply_on_parents.
-    ASSERT(parent_info.classification().ply() == Classification::unknown_ply);
-
-    // Inform parent that another child has its mate_in_ply_ set.
-    // Append the parent to parents_out if the parent is now known to be mate in `min_ply` moves because this was its last child.
-    std::mutex& m = graph.get_mutex(parent);
-    if (parent_auxiliary_info.increment_processed_children(m, parent_info.number_of_children()))  // Was this the last child?
+    //Dout(dc::notice, "    with info: " << *parent_infos[i]);
+    if (parent_infos[i]->black_to_move_parent_reached(*parent_auxiliary_infos[i], min_ply))
     {
-      // This is single-threaded (only executed for the last child).
-      //Dout(dc::notice, "Setting ply (" << min_ply << ") on " << parent);
-      parent_info.classification().set_mate_in_ply(min_ply);
       //Dout(dc::notice, "Adding parent " << parent);
-      parents_out.push_back(parent);
+      parents_out.insert(parent);
     }
   }
 }
 
+bool Info::black_to_move_parent_reached(AuxiliaryInfo& auxiliary_info, Classification::ply_type min_ply)
+{
+  Classification const parent_classification = classification_.atomic_load();
+  // All returned parent positions should be legal.
+  ASSERT(parent_classification.is_legal());
+
+  // If black already has a draw in this (parent) position then it will never do the move that ends up as the current position.
+  if (parent_classification.is_draw())
+  {
+    SolverCounters::add(SolverCounters::draw_skips);
+    return false;
+  }
+
+  // Call white_to_move_set_minimum_ply_on_parents exactly once for each position (where white is to move).
+  // In that case, the mate_in_ply_ member is only set after the last child called white_to_move_set_minimum_ply_on_parents.
+  ASSERT(parent_classification.ply() == Classification::unknown_ply);
+
+  // Inform parent that another child has its mate_in_ply_ set.
+  // The parent is now known to be mate in `min_ply` moves if this was its last child.
+  if (!auxiliary_info.increment_processed_children(number_of_children_))  // Was this the last child?
+    return false;
+
+  // Only executed by the thread that processed the last child.
+  //Dout(dc::notice, "Setting ply (" << min_ply << ")");
+  [[maybe_unused]] bool const was_unknown = classification_.set_mate_in_ply_if_unknown(min_ply);
+  ASSERT(was_unknown);
+  SolverCounters::add(SolverCounters::parents_accepted);
+  return true;
+}
+
 #ifdef CWDEBUG
 void Info::print_on(std::ostream& os) const
 {
@@ -109,3 +157,5 @@ void AuxiliaryInfo::print_on(std::ostream& os) const
   os << '}';
 }
 #endif
+
+} // namespace SIZE_NAMESPACE
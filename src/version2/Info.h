@@ -7,8 +7,13 @@
 #include "utils/Array.h"
 #include <limits>
 #include <cmath>
+#include <atomic>
+
+inline namespace SIZE_NAMESPACE {
 
 class Graph;
+class Frontier;
+class AuxiliaryInfo;
 
 // This class defines a print_on method.
 using utils::has_print_on::operator<<;
@@ -52,8 +57,14 @@ class Info
   degree_type number_of_children() const { return number_of_children_; }
 
   // Given that black is to move, set the mate_in_ply_ value on each of the parent positions.
-  void black_to_move_set_maximum_ply_on_parents(Board const current_board, Graph& graph, std::vector<Board>& parents_out);
-  void white_to_move_set_minimum_ply_on_parents(Board const current_board, Graph& graph, std::vector<Board>& parents_out);
+  // Parents whose ply is determined as a result are added to parents_out.
+  void black_to_move_set_maximum_ply_on_parents(Board const current_board, Graph& graph, Frontier& parents_out);
+  void white_to_move_set_minimum_ply_on_parents(Board const current_board, Graph& graph, Frontier& parents_out);
+
+  // The update of a single parent (this object) by a child whose ply is one less than the ply passed.
+  // Returns true if this set the ply of the parent, which then has to be added to the next frontier.
+  bool white_to_move_parent_reached(Classification::ply_type max_ply);
+  bool black_to_move_parent_reached(AuxiliaryInfo& auxiliary_info, Classification::ply_type min_ply);
 
   void set_number_of_children(degree_type number_of_children)
   {
@@ -68,7 +79,7 @@ class Info
 #endif
 };
 
-// Data that one-on-one matches an Info, but is not memory-mapped.
+// Data that one-on-one matches an Info, but is not stored: it is kept in anonymous memory (see Graph and ScratchMemory).
 class AuxiliaryInfo
 {
  public:
@@ -78,6 +89,8 @@ class AuxiliaryInfo
  private:
   Info::degree_type number_of_visited_children_;        // The number of children that visited this parent, during generation of the graph.
 
+  static_assert(std::atomic_ref<Info::degree_type>::is_always_lock_free, "AuxiliaryInfo::number_of_visited_children_ must be lock-free.");
+
  public:
   void initialize()
   {
@@ -89,17 +102,25 @@ class AuxiliaryInfo
     initialize();
   }
 
-  // Returns true if this was the last child.
-  bool increment_processed_children(std::mutex& m, Info::degree_type number_of_children)
+  // Used when resuming from a Checkpoint.
+  void set_number_of_visited_children(Info::degree_type number_of_visited_children)
+  {
+    number_of_visited_children_ = number_of_visited_children;
+  }
+
+  // Returns true if this was the last child. This function is thread-safe.
+  bool increment_processed_children(Info::degree_type number_of_children)
   {
     // Call set_number_of_children first.
     ASSERT(number_of_children > 0);
 
-    std::lock_guard<std::mutex> const lock(m);
+    // Use acq_rel so that everything the other children did with the parent happens before the last child sets its ply.
+    Info::degree_type const visited_children =
+      std::atomic_ref<Info::degree_type>(number_of_visited_children_).fetch_add(1, std::memory_order_acq_rel) + 1;
 
     // This should be called exactly once for each child position.
-    ASSERT(number_of_visited_children_ < number_of_children);
-    return ++number_of_visited_children_ == number_of_children;
+    ASSERT(visited_children <= number_of_children);
+    return visited_children == number_of_children;
   }
 
  public:
@@ -110,3 +131,5 @@ class AuxiliaryInfo
 
 // Make sure that we have a zero-cost default constructor (and destructor).
 static_assert(std::is_trivial<Info>::value, "Info must be a trivial type for zero-cost abstractions.");
+
+} // namespace SIZE_NAMESPACE
@@ -1,6 +1,8 @@
 #include "sys.h"
 #include "KingSquare.h"
 
+inline namespace SIZE_NAMESPACE {
+
 #ifdef CWDEBUG
 void KingSquare::print_on(std::ostream& os) const
 {
@@ -13,3 +15,5 @@ void KingSquare::print_on(std::ostream& os) const
   os << '}';
 }
 #endif
+
+} // namespace SIZE_NAMESPACE
@@ -4,6 +4,8 @@
 #include "BlockSquareCompact.h"
 #include "utils/has_print_on.h"
 
+inline namespace SIZE_NAMESPACE {
+
 // This class defines a print_on method.
 using utils::has_print_on::operator<<;
 
@@ -75,3 +77,5 @@ class KingSquare
   void print_on(std::ostream& os) const;
 #endif
 };
+
+} // namespace SIZE_NAMESPACE
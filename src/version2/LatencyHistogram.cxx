@@ -0,0 +1,61 @@
+#include "sys.h"
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <bit>
+#include <iostream>
+#include "debug.h"
+
+//static
+int LatencyHistogram::bucket(uint64_t ns)
+{
+  if (ns < linear_buckets)
+    return ns;
+  // The index of the most significant bit (at least 4).
+  int const exponent = std::bit_width(ns) - 1;
+  // The next three bits.
+  int const sub_bucket = (ns >> (exponent - 3)) & (sub_buckets - 1);
+  return linear_buckets + (exponent - 4) * sub_buckets + sub_bucket;
+}
+
+//static
+uint64_t LatencyHistogram::bucket_upper_bound(int bucket)
+{
+  if (bucket < linear_buckets)
+    return bucket;
+  int const exponent = (bucket - linear_buckets) / sub_buckets + 4;
+  uint64_t const sub_bucket = (bucket - linear_buckets) % sub_buckets;
+  // The last value that still falls in this bucket.
+  return ((sub_buckets + sub_bucket + 1) << (exponent - 3)) - 1;
+}
+
+void LatencyHistogram::add_to(Snapshot& snapshot) const
+{
+  for (int b = 0; b < number_of_buckets; ++b)
+  {
+    uint64_t const count = count_[b].load(std::memory_order_relaxed);
+    snapshot.count[b] += count;
+    snapshot.total += count;
+  }
+  snapshot.max_ns = std::max(snapshot.max_ns, max_ns_.load(std::memory_order_relaxed));
+}
+
+uint64_t LatencyHistogram::Snapshot::percentile(double fraction) const
+{
+  // The number of values that must be less than or equal the returned value.
+  uint64_t const needed = std::max(uint64_t{1}, static_cast<uint64_t>(fraction * total + 0.5));
+  uint64_t seen = 0;
+  for (int b = 0; b < number_of_buckets; ++b)
+  {
+    seen += count[b];
+    if (seen >= needed)
+      return std::min(bucket_upper_bound(b), max_ns);
+  }
+  return max_ns;
+}
+
+void LatencyHistogram::Snapshot::print_on(std::ostream& os) const
+{
+  auto us = [](uint64_t ns){ return ns / 1000.0; };
+  os << total << " requests; latency (us): p50 = " << us(percentile(0.5)) << ", p90 = " << us(percentile(0.9)) <<
+    ", p99 = " << us(percentile(0.99)) << ", p99.9 = " << us(percentile(0.999)) << ", max = " << us(max_ns);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+
+// A histogram of latencies with logarithmic buckets.
+//
+// Values below 16 ns each have their own bucket; above that every power of two is divided into
+// eight buckets, so that a percentile is known to within 12.5%.
+//
+// Recording is meant to be done by a single thread (it is not a read-modify-write), while any
+// other thread may read the counts at the same time (see add_to).
+class LatencyHistogram
+{
+ public:
+  using clock_type = std::chrono::steady_clock;
+
+  static constexpr int sub_buckets = 8;
+  static constexpr int linear_buckets = 2 * sub_buckets;
+  static constexpr int number_of_buckets = linear_buckets + (64 - 4) * sub_buckets;
+
+  // A (non-atomic) copy of the counts of one or more histograms.
+  struct Snapshot
+  {
+    std::array<uint64_t, number_of_buckets> count{};
+    uint64_t total{};
+    uint64_t max_ns{};
+
+    // Returns an upper bound of the latency (in ns) below which `fraction` of the recorded values lie.
+    uint64_t percentile(double fraction) const;
+
+    void print_on(std::ostream& os) const;
+  };
+
+ private:
+  std::array<std::atomic<uint64_t>, number_of_buckets> count_{};
+  std::atomic<uint64_t> max_ns_{};
+
+  static int bucket(uint64_t ns);
+  static uint64_t bucket_upper_bound(int bucket);
+
+ public:
+  // Record one latency. Must always be called by the same thread.
+  void record(clock_type::duration latency)
+  {
+    uint64_t const ns = std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count();
+    std::atomic<uint64_t>& count = count_[bucket(ns)];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (ns > max_ns_.load(std::memory_order_relaxed))
+      max_ns_.store(ns, std::memory_order_relaxed);
+  }
+
+  // Add the current counts of this histogram to `snapshot`. This function is thread-safe.
+  void add_to(Snapshot& snapshot) const;
+};
@@ -3,18 +3,115 @@
 #include "BlockIndex.h"
 #include "utils/VectorIndex.h"
 #include "utils/square.h"
+#include <array>
+#include <cstdint>
+
+inline namespace SIZE_NAMESPACE {
 
 class Partition;
 using PartitionIndex = utils::VectorIndex<Partition>;
 
+namespace partition_folding {
+
+// The number of (black king block, white king block) pairs; this would be the number of partitions without folding.
+inline constexpr size_t number_of_block_pairs = utils::square(BlockIndex::number_of_blocks);
+
+// Returns true if the partition with the black king in block `bk` and the white king in block `wk` is stored.
+//
+// If Size::diagonal_symmetry is set then a partition and its mirror image contain the same information.
+// We keep the partition where the first king (black first) that is not in a block on the diagonal, is
+// below the diagonal. If both kings are in a block on the diagonal then the partition is its own mirror
+// image and it is stored as a whole (see Board::is_canonical for which positions in it are actually used).
+//
+//    +---+---+---+
+//    | 6 | 7 | 8 |      For example, with the black king in block 1 the partitions with the white king
+//    +---+---+---+      in any block are stored (1 is below the diagonal), with the black king in block 3
+//    | 3 | 4 | 5 |      no partitions are stored (they are the mirror images of those with the black king
+//    +---+---+---+      in block 1) and with the black king in block 4 only the partitions with the white
+//    | 0 | 1 | 2 |      king in block 0, 1, 2, 4, 5 or 8 are stored.
+//    +---+---+---+
+//
+constexpr bool is_canonical(BlockIndex::index_type bk, BlockIndex::index_type wk)
+{
+  if (!Size::diagonal_symmetry)
+    return true;
+  int side = BlockIndex::diagonal_side(bk);
+  if (side == 0)
+    side = BlockIndex::diagonal_side(wk);
+  return side >= 0;
+}
+
+consteval size_t count_canonical()
+{
+  size_t count = 0;
+  for (size_t unfolded = 0; unfolded < number_of_block_pairs; ++unfolded)
+    if (is_canonical(unfolded / BlockIndex::number_of_blocks, unfolded % BlockIndex::number_of_blocks))
+      ++count;
+  return count;
+}
+
+// The number of partitions that are actually stored.
+inline constexpr size_t number_of_partitions = count_canonical();
+
+// Translation tables between the "unfolded" index (wk + number_of_blocks * bk) and a PartitionIndex.
+struct Tables
+{
+  std::array<uint32_t, number_of_block_pairs> folded;   // Unfolded index --> PartitionIndex (or -1 if that partition isn't stored).
+  std::array<uint32_t, number_of_partitions> unfolded;  // PartitionIndex --> unfolded index.
+};
+
+consteval Tables make_tables()
+{
+  Tables tables{};
+  uint32_t partition_index = 0;
+  for (size_t unfolded = 0; unfolded < number_of_block_pairs; ++unfolded)
+  {
+    if (is_canonical(unfolded / BlockIndex::number_of_blocks, unfolded % BlockIndex::number_of_blocks))
+    {
+      tables.unfolded[partition_index] = unfolded;
+      tables.folded[unfolded] = partition_index++;
+    }
+    else
+      tables.folded[unfolded] = static_cast<uint32_t>(-1);
+  }
+  return tables;
+}
+
+inline constexpr Tables tables = make_tables();
+
+inline size_t fold(size_t unfolded)
+{
+  if constexpr (!Size::diagonal_symmetry)
+    return unfolded;
+  else
+    return tables.folded[unfolded];
+}
+
+inline size_t unfold(size_t partition_index)
+{
+  if constexpr (!Size::diagonal_symmetry)
+    return partition_index;
+  else
+    return tables.unfolded[partition_index];
+}
+
+} // namespace partition_folding
+
 class Partition
 {
+ public:
+  static constexpr size_t number_of_partitions = partition_folding::number_of_partitions;
+
  private:
   PartitionIndex index_;
 
  public:
+  // The pair of blocks must be canonical: call Board::canonical() before converting a Board into a Partition.
   Partition(BlockIndex black_king, BlockIndex white_king) :
-    index_(white_king.index() + BlockIndex::number_of_blocks * black_king.index()) { }
+    index_(partition_folding::fold(white_king.index() + BlockIndex::number_of_blocks * black_king.index()))
+  {
+    ASSERT(partition_folding::is_canonical(black_king.index(), white_king.index()));
+  }
 
   Partition(PartitionIndex partition_index) : index_(partition_index) { }
 
@@ -23,8 +120,13 @@ class Partition
   // Accessor.
   operator PartitionIndex() const { return index_; }
 
-  BlockIndex black_king_block_index() const { return static_cast<BlockIndex::index_type>(index_.get_value() / BlockIndex::number_of_blocks); }
-  BlockIndex white_king_block_index() const { return index_.get_value() % BlockIndex::number_of_blocks; }
+  BlockIndex black_king_block_index() const { return static_cast<BlockIndex::index_type>(unfolded_index() / BlockIndex::number_of_blocks); }
+  BlockIndex white_king_block_index() const { return static_cast<BlockIndex::index_type>(unfolded_index() % BlockIndex::number_of_blocks); }
 
   friend bool operator!=(Partition lhs, Partition rhs) { return lhs.index_ != rhs.index_; }
+
+ private:
+  size_t unfolded_index() const { return partition_folding::unfold(index_.get_value()); }
 };
+
+} // namespace SIZE_NAMESPACE
@@ -5,51 +5,130 @@
 #include "WhiteRookSquare.h"
 #include "SquareCompact.h"
 #include "utils/VectorIndex.h"
+#include <array>
+#include <cstdint>
+
+inline namespace SIZE_NAMESPACE {
 
 class PartitionElement;
 using InfoIndex = utils::VectorIndex<PartitionElement>;
 
-// A PartitionElement wraps a size_t that encodes the coordinates of three squares as:
-//   [ unused ][      black-king-square       ][       white-king-square      ][      white-rook-square       ]
-//               Size::block::                   Size::block::                   Size::board::
-//             [ y-coord-bits ][ x-coord-bits ][ y-coord-bits ][ x-coord-bits ][ y-coord-bits ][ x-coord-bits ]
-//             <---------square_bits----------><---------square_bits----------><---------square_bits---------->
-//             <-coord_bits_y-><-coord_bits_x-><-coord_bits_y-><-coord_bits_x-><-coord_bits_y-><-coord_bits_x->
-//   <------------------------------------------64 bits------------------------------------------------------->
+#ifndef INFCHESS_MORTON
+#define INFCHESS_MORTON 0       // Define as 1 to number the squares of a block in Z-order (see BlockSquareOrder).
+#endif
+
+// The numbering of the squares of a block, used for both kings in a PartitionElement.
+//
+// By default the squares are numbered row by row (y * Bx + x), so that a king step in y jumps Bx times further
+// through the Info arrays than a king step in x. With INFCHESS_MORTON the squares are numbered in Z-order (Morton
+// order: the bits of x and y interleaved, skipping the codes that fall outside the block), so that most king steps
+// in either direction stay within the same quad of squares and the parents of a position are closer together in memory.
+struct BlockSquareOrder
+{
+  static constexpr bool morton = INFCHESS_MORTON;
+  static constexpr size_t number_of_squares = Size::block::x * Size::block::y;
+
+  std::array<uint32_t, number_of_squares> number;       // y * Bx + x --> the number of that square.
+  std::array<uint32_t, number_of_squares> square;       // The number of a square --> y * Bx + x.
+};
+
+consteval BlockSquareOrder make_block_square_order()
+{
+  BlockSquareOrder order{};
+  uint32_t number = 0;
+  for (uint32_t code = 0; number < BlockSquareOrder::number_of_squares; ++code)
+  {
+    uint32_t x = code % Size::block::x;
+    uint32_t y = code / Size::block::x;
+    if (BlockSquareOrder::morton)
+    {
+      x = y = 0;
+      for (int bit = 0; bit < 16; ++bit)
+      {
+        x |= ((code >> (2 * bit)) & 1) << bit;
+        y |= ((code >> (2 * bit + 1)) & 1) << bit;
+      }
+    }
+    if (x < Size::block::x && y < Size::block::y)
+    {
+      order.number[y * Size::block::x + x] = number;
+      order.square[number++] = y * Size::block::x + x;
+    }
+  }
+  return order;
+}
+
+inline constexpr BlockSquareOrder block_square_order = make_block_square_order();
+
+// A PartitionElement wraps a size_t that encodes the coordinates of three squares as a mixed-radix number:
 //
-// Both coord_bits_y and coord_bits_x are the minimum required width in bits.
+//   [    black-king-square    ][    white-king-square    ][    white-rook-square    ]
+//         Size::block::               Size::block::               Size::board::
+//   [   number of the square  ][   number of the square  ][   y-coord  ][   x-coord  ]
+//            radix Bx * By              radix Bx * By         radix y      radix x
+//
+// That is, index = wrx + x * (wry + y * (wk + Bx * By * bk)), where x, y is the size of the board and bk and wk
+// are the numbers of the squares of the kings in their block (see BlockSquareOrder; by default bk = bky * Bx + bkx).
+// Every index less than number_of_elements is a position (legal or not), so no space is wasted on padding when a size
+// isn't a power of two. If all sizes are a power of two (and without INFCHESS_MORTON) then this is the same as
+// concatenating the bits of the three SquareCompact coordinates.
 //
 struct PartitionElementBase
 {
+  static constexpr size_t king_squares = Size::block::x * Size::block::y;       // The number of squares of a block.
+  static constexpr size_t rook_squares = Size::board::x * Size::board::y;       // The number of squares of the board.
+
+  // Returns y * width + x.
+  template<RectangleSizeConcept RectangleSize>
+  static constexpr size_t row_major(SquareCompact<RectangleSize> square)
+  {
+    return RectangleSize::y_coord(square.coordinates()) * RectangleSize::x + RectangleSize::x_coord(square.coordinates());
+  }
+
+  static constexpr size_t compose(size_t black_king, size_t white_king, size_t white_rook)
+  {
+    return (black_king * king_squares + white_king) * rook_squares + white_rook;
+  }
+
   static constexpr InfoIndex info_index(
       SquareCompact<Size::block> black_king, SquareCompact<Size::block> white_king, SquareCompact<Size::board> white_rook)
   {
-    size_t encoded = black_king.coordinates();
-        // Size::block:: [ y-coord-bits ][ x-coord-bits ]
-        //               <---------square_bits---------->
-    encoded <<= Size::block::square_bits;  //            <<============shift=============
-    encoded |= white_king.coordinates();// Size::block:: [ y-coord-bits ][ x-coord-bits ]
-                                           //            <---------square_bits---------->
-    encoded <<= Size::board::square_bits;  //                                            <<============shift=============
-    encoded |= white_rook.coordinates();   //                              Size::board:: [ y-coord-bits ][ x-coord-bits ]
-                                           //                                            <---------square_bits---------->
-    return InfoIndex{encoded};
+    if constexpr (!BlockSquareOrder::morton)
+      return InfoIndex{compose(row_major(black_king), row_major(white_king), row_major(white_rook))};
+    else
+      return InfoIndex{compose(block_square_order.number[row_major(black_king)], block_square_order.number[row_major(white_king)],
+          row_major(white_rook))};
+  }
+
+  // The index of a position in the tables of tablebase.dtm (see Tablebase.h): the same as info_index, but always
+  // with the squares of a block numbered row by row, so that the file doesn't depend on INFCHESS_MORTON.
+  static constexpr size_t table_index(
+      SquareCompact<Size::block> black_king, SquareCompact<Size::block> white_king, SquareCompact<Size::board> white_rook)
+  {
+    return compose(row_major(black_king), row_major(white_king), row_major(white_rook));
   }
 };
 
 class PartitionElement : private PartitionElementBase
 {
-  static constexpr SquareCompact<Size::block> bks{Size::block::limit_y | Size::block::limit_x};
-  static constexpr SquareCompact<Size::block> wks{Size::block::limit_y | Size::block::limit_x};
-  static constexpr SquareCompact<Size::board> wrs{Size::board::limit_y | Size::board::limit_x};
-
  public:
   // This is the number of elements in a single Partition: one more than the largest value that will ever be stored in an InfoIndex.
-  static constexpr size_t number_of_elements = info_index(bks, wks, wrs).get_value() + 1;
+  static constexpr size_t number_of_elements = king_squares * king_squares * rook_squares;
+  static constexpr InfoIndex end{number_of_elements};
+  // True if all sizes are a power of two: then the index is the same as that of the bit packed layout of tablebase
+  // version 1 and checkpoint version 1 (the SquareCompact coordinates concatenated), and those files can still be used.
+  static constexpr bool same_as_bit_packed = !BlockSquareOrder::morton &&
+    number_of_elements == size_t{1} << (2 * Size::block::square_bits + Size::board::square_bits);
 
  private:
   InfoIndex index_;
 
+  static BlockSquareCompact block_square(size_t number)
+  {
+    size_t const square = BlockSquareOrder::morton ? block_square_order.square[number] : number;
+    return {static_cast<int>(square % Size::block::x), static_cast<int>(square / Size::block::x)};
+  }
+
  public:
   constexpr PartitionElement(InfoIndex info_index) : index_(info_index) { }
   constexpr PartitionElement(
@@ -57,78 +136,35 @@ class PartitionElement : private PartitionElementBase
       SquareCompact<Size::block> white_king,
       SquareCompact<Size::board> white_rook) : PartitionElement(info_index(black_king, white_king, white_rook)) { }
 
-  // Constants used by the increment operator.
-  static constexpr InfoIndex rook_limit_x{Size::board::limit_x};
-  static constexpr InfoIndex rook_limit_y{Size::board::limit_y};
-  static constexpr size_t rook_unit_y{size_t{1} << Size::board::coord_bits_x};
-  static constexpr size_t rook_x_coord_mask{Size::board::mask_x};
-  static constexpr size_t rook_y_coord_mask{Size::board::mask_y};
-  static constexpr int white_king_shift{Size::board::square_bits};
-  static constexpr InfoIndex wk_limit_x{Size::block::limit_x << white_king_shift};
-  static constexpr InfoIndex wk_limit_y{Size::block::limit_y << white_king_shift};
-  static constexpr size_t wk_unit_x{size_t{1} << white_king_shift};
-  static constexpr size_t wk_unit_y{wk_unit_x << Size::block::coord_bits_x};
-  static constexpr size_t wk_x_coord_mask{Size::block::mask_x << white_king_shift};
-  static constexpr size_t wk_y_coord_mask{Size::block::mask_y << white_king_shift};
-  static constexpr int black_king_shift{white_king_shift + Size::block::square_bits};
-  static constexpr InfoIndex bk_limit_x{Size::block::limit_x << black_king_shift};
-  static constexpr InfoIndex bk_limit_y{Size::block::limit_y << black_king_shift};
-  static constexpr size_t bk_unit_x{size_t{1} << black_king_shift};
-  static constexpr size_t bk_unit_y{bk_unit_x << Size::block::coord_bits_x};
-  static constexpr size_t bk_x_coord_mask{Size::block::mask_x << black_king_shift};
-  static constexpr size_t bk_y_coord_mask{Size::block::mask_y << black_king_shift};
-  static constexpr InfoIndex end{number_of_elements};
-
+  // Every index is used, so the next element is simply the next index.
   PartitionElement& operator++()
   {
-    if ((index_ & rook_x_coord_mask) < rook_limit_x)    // Can the x-coordinate of the rook still be incremented?
-      ++index_;
-    else
-    {
-      index_ &= ~rook_x_coord_mask;                     // Reset the rook x-coordinate to zero.
-      if ((index_ & rook_y_coord_mask) < rook_limit_y)  // Can the y-coordinate of the rook still be incremented?
-        index_ += rook_unit_y;
-      else
-      {
-        index_ &= ~rook_y_coord_mask;                   // Reset the rook y-coordinate to zero.
-        if ((index_ & wk_x_coord_mask) < wk_limit_x)
-          index_ += wk_unit_x;
-        else
-        {
-          index_ &= ~wk_x_coord_mask;
-          if ((index_ & wk_y_coord_mask) < wk_limit_y)
-            index_ += wk_unit_y;
-          else
-          {
-            index_ &= ~wk_y_coord_mask;
-            if ((index_ & bk_x_coord_mask) < bk_limit_x)
-              index_ += bk_unit_x;
-            else
-            {
-              index_ &= ~bk_x_coord_mask;
-              if ((index_ & bk_y_coord_mask) < bk_limit_y)
-                index_ += bk_unit_y;
-              else
-                index_ = end;
-            }
-          }
-        }
-      }
-    }
+    ++index_;
     return *this;
   }
 
   BlockSquareCompact black_king_square() const
   {
-    return static_cast<Size::block::coordinates_type>(index_.get_value() >> (Size::block::square_bits + Size::board::square_bits));
+    return block_square(index_.get_value() / (king_squares * rook_squares));
   }
   BlockSquareCompact white_king_square() const
   {
-    return static_cast<Size::block::coordinates_type>((index_.get_value() >> Size::board::square_bits) & Size::block::square_mask);
+    return block_square(index_.get_value() / rook_squares % king_squares);
   }
   SquareCompact<Size::board> white_rook_square() const
   {
-    return static_cast<Size::board::coordinates_type>(index_.get_value() & Size::board::square_mask);
+    size_t const square = index_.get_value() % rook_squares;
+    return {static_cast<int>(square % Size::board::x), static_cast<int>(square / Size::board::x)};
+  }
+
+  using PartitionElementBase::table_index;
+  // The index of this element in the tables of tablebase.dtm.
+  size_t table_index() const
+  {
+    if constexpr (!BlockSquareOrder::morton)
+      return index_.get_value();
+    else
+      return table_index(black_king_square(), white_king_square(), white_rook_square());
   }
 
   // Accessor.
@@ -137,3 +173,4 @@ class PartitionElement : private PartitionElementBase
   friend bool operator!=(PartitionElement lhs, PartitionElement rhs) { return lhs.index_ != rhs.index_; }
 };
 
+} // namespace SIZE_NAMESPACE
@@ -0,0 +1,142 @@
+#include "sys.h"
+#include "PartitionScheduler.h"
+#include <algorithm>
+#include "debug.h"
+
+inline namespace SIZE_NAMESPACE {
+
+namespace {
+
+// Returns the partition with the black king in block `bk` and the white king in block `wk`, mirrored if necessary.
+Partition canonical_partition(BlockIndex::index_type bk, BlockIndex::index_type wk)
+{
+  if (!partition_folding::is_canonical(bk, wk))
+  {
+    // Mirror both blocks in the diagonal (only possible if Size::diagonal_symmetry is set, in which case Px == Py).
+    bk = (bk % BlockIndex::Px) * BlockIndex::Px + bk / BlockIndex::Px;
+    wk = (wk % BlockIndex::Px) * BlockIndex::Px + wk / BlockIndex::Px;
+  }
+  return {BlockIndex{bk}, BlockIndex{wk}};
+}
+
+// Returns the partitions that contain the parents of the positions in `partition`, with `child_to_move` to move.
+// The parents of a white to move position are reached by moving the black king, those of a black to move
+// position by moving the white king or rook (the latter doesn't change the partition).
+PartitionScheduler::group_type neighbor_closure(Partition partition, color_type child_to_move)
+{
+  BlockIndex::index_type const bk = partition.black_king_block_index().index();
+  BlockIndex::index_type const wk = partition.white_king_block_index().index();
+  BlockIndex::index_type const moving = child_to_move == white ? bk : wk;
+  int const x = moving % BlockIndex::Px;
+  int const y = moving / BlockIndex::Px;
+  PartitionScheduler::group_type closure;
+  for (int dy = -1; dy <= 1; ++dy)
+    for (int dx = -1; dx <= 1; ++dx)
+    {
+      if (x + dx < 0 || x + dx >= static_cast<int>(BlockIndex::Px) || y + dy < 0 || y + dy >= static_cast<int>(BlockIndex::Py))
+        continue;
+      BlockIndex::index_type const moved = (y + dy) * BlockIndex::Px + x + dx;
+      Partition const neighbor = child_to_move == white ? canonical_partition(moved, wk) : canonical_partition(bk, moved);
+      auto same_partition = [neighbor](Partition partition){
+        return static_cast<PartitionIndex>(partition).get_value() == static_cast<PartitionIndex>(neighbor).get_value(); };
+      if (std::find_if(closure.begin(), closure.end(), same_partition) == closure.end())
+        closure.push_back(neighbor);
+    }
+  return closure;
+}
+
+} // namespace
+
+PartitionScheduler::PartitionScheduler(size_t memory_budget) :
+  memory_budget_(memory_budget), resident_(Partition::number_of_partitions * 2 * number_of_range_types)
+{
+  for (int color = 0; color < 2; ++color)
+  {
+    neighbor_closures_[color].reserve(Partition::number_of_partitions);
+    for (Partition partition = PartitionIndex{size_t{0}}; partition != PartitionIndex{Partition::number_of_partitions}; ++partition)
+      neighbor_closures_[color].push_back(neighbor_closure(partition, static_cast<color_type>(color)));
+  }
+}
+
+//static
+size_t PartitionScheduler::range_index(Partition partition, color_type to_move, range_type range)
+{
+  return (static_cast<PartitionIndex>(partition).get_value() * 2 + to_move) * number_of_range_types + range;
+}
+
+//static
+size_t PartitionScheduler::range_size(range_type range)
+{
+  return range == auxiliary_infos ? sizeof(AuxiliaryInfo::nodes_type) : sizeof(Info::nodes_type);
+}
+
+template<typename VISIT>
+void PartitionScheduler::for_each_range(Partition partition, color_type child_to_move, VISIT const& visit) const
+{
+  color_type const parent_to_move = Color{child_to_move}.opponent();
+  visit(range_index(partition, child_to_move, infos), range_size(infos));
+  for (Partition parent_partition : neighbor_closures_[child_to_move][static_cast<PartitionIndex>(partition).get_value()])
+  {
+    visit(range_index(parent_partition, parent_to_move, infos), range_size(infos));
+    // Only black to move parents use their AuxiliaryInfo.
+    if (parent_to_move == black)
+      visit(range_index(parent_partition, parent_to_move, auxiliary_infos), range_size(auxiliary_infos));
+  }
+}
+
+std::vector<PartitionScheduler::group_type> PartitionScheduler::make_groups(Color child_to_move, std::vector<Partition> const& partitions) const
+{
+  std::vector<group_type> groups;
+  std::vector<uint8_t> in_group(resident_.size());
+  std::vector<size_t> group_ranges;     // The ranges that are set in in_group.
+  size_t group_bytes = 0;
+  for (Partition partition : partitions)
+  {
+    // Calculate how much memory adding this partition to the current group would add.
+    size_t extra_bytes = 0;
+    for_each_range(partition, child_to_move, [&](size_t range, size_t size){
+      if (!in_group[range])
+        extra_bytes += size;
+    });
+    // Start a new group if the current one would become too large (but always put at least one partition in a group).
+    if (groups.empty() || (group_bytes + extra_bytes > memory_budget_ && !groups.back().empty()))
+    {
+      for (size_t range : group_ranges)
+        in_group[range] = 0;
+      group_ranges.clear();
+      group_bytes = 0;
+      groups.emplace_back();
+    }
+    for_each_range(partition, child_to_move, [&](size_t range, size_t size){
+      if (!in_group[range])
+      {
+        in_group[range] = 1;
+        group_ranges.push_back(range);
+        group_bytes += size;
+      }
+    });
+    groups.back().push_back(partition);
+  }
+  return groups;
+}
+
+void PartitionScheduler::make_resident(Graph& graph, Color child_to_move, group_type const& group)
+{
+  std::vector<uint8_t> needed(resident_.size());
+  for (Partition partition : group)
+    for_each_range(partition, child_to_move, [&](size_t range, size_t){ needed[range] = 1; });
+
+  for (size_t range = 0; range < resident_.size(); ++range)
+  {
+    if (needed[range] == resident_[range])
+      continue;
+    // Decode range_index.
+    Partition const partition = PartitionIndex{range / (2 * number_of_range_types)};
+    color_type const to_move = static_cast<color_type>((range / number_of_range_types) % 2);
+    range_type const type = static_cast<range_type>(range % number_of_range_types);
+    graph.advise(partition, to_move, type == auxiliary_infos, needed[range] ? Graph::Advice::will_need : Graph::Advice::dont_need);
+    resident_[range] = needed[range];
+  }
+}
+
+} // namespace SIZE_NAMESPACE
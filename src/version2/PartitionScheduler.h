@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Frontier.h"
+#include "Graph.h"
+#include "run_chunked.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+inline namespace SIZE_NAMESPACE {
+
+// Processes a Frontier in groups of partitions whose working set fits in a memory budget.
+//
+// Processing the positions of a partition accesses the Info of that partition (the children), and the
+// Info of the parents, which are in the same partition or in a partition where one king is in an adjacent
+// block (the "neighbor closure" of the partition). For black to move parents also the AuxiliaryInfo is needed.
+//
+// The used partitions of the frontier are split, in order, into groups such that the children and the neighbor
+// closure of all partitions of a group fit in the memory budget. Before a group is processed the kernel is told
+// (madvise) that its working set will be needed, and that the data of the previous group that is not part of
+// it isn't needed anymore. With a budget of zero the whole frontier is processed at once, without any advice.
+class PartitionScheduler
+{
+ public:
+  using group_type = std::vector<Partition>;
+
+ private:
+  size_t memory_budget_;                                        // In bytes; zero means unlimited.
+  std::array<std::vector<group_type>, 2> neighbor_closures_;    // Indexed by the color of the children, and the PartitionIndex.
+  std::vector<uint8_t> resident_;                               // Non-zero for each range (see range_index) that was last advised as will_need.
+  size_t number_of_groups_ = 0;                                 // The number of groups used by the last call to for_each.
+
+ public:
+  PartitionScheduler(size_t memory_budget);
+
+  // Call `body(task_n, Board)` for every position in `children` (with `child_to_move` to move), group by group.
+  template<typename BODY>
+  ChunkedRunTimes for_each(AIThreadPool& thread_pool, AIQueueHandle queue_handle, int number_of_tasks,
+      Graph& graph, Color child_to_move, Frontier const& children, BODY const& body)
+  {
+    if (memory_budget_ == 0)
+    {
+      number_of_groups_ = 1;
+      return children.for_each(thread_pool, queue_handle, number_of_tasks, body);
+    }
+    ChunkedRunTimes times;
+    std::vector<group_type> const groups = make_groups(child_to_move, children.used_partitions());
+    for (group_type const& group : groups)
+    {
+      make_resident(graph, child_to_move, group);
+      times += children.for_each(thread_pool, queue_handle, number_of_tasks, group, body);
+    }
+    number_of_groups_ = groups.size();
+    return times;
+  }
+
+  // Accessor.
+  size_t number_of_groups() const { return number_of_groups_; }
+
+ private:
+  // The ranges of memory (see Graph::advise) per partition and color.
+  enum range_type
+  {
+    infos,
+    auxiliary_infos,
+    number_of_range_types
+  };
+
+  // A unique number for each (partition, to_move, range type).
+  static size_t range_index(Partition partition, color_type to_move, range_type range);
+  static size_t range_size(range_type range);
+
+  // Call `visit(range_index, range_size)` for each range in the working set of `partition`.
+  template<typename VISIT>
+  void for_each_range(Partition partition, color_type child_to_move, VISIT const& visit) const;
+
+  std::vector<group_type> make_groups(Color child_to_move, std::vector<Partition> const& partitions) const;
+  void make_resident(Graph& graph, Color child_to_move, group_type const& group);
+};
+
+} // namespace SIZE_NAMESPACE
@@ -0,0 +1,116 @@
+#include "sys.h"
+#include "PlyMetrics.h"
+#include "Size.h"
+#include "PartitionElement.h"
+#include "utils/AIAlert.h"
+#include <tuple>
+#include <sys/resource.h>
+#include "debug.h"
+
+inline namespace SIZE_NAMESPACE {
+
+namespace {
+
+// Returns the number of minor and major page faults of this process so far.
+std::pair<uint64_t, uint64_t> page_faults()
+{
+  struct rusage usage;
+  if (::getrusage(RUSAGE_SELF, &usage) == -1)
+    return {0, 0};
+  return {usage.ru_minflt, usage.ru_majflt};
+}
+
+// Returns the largest resident set size of this process so far, in kB.
+long peak_rss_kb()
+{
+  struct rusage usage;
+  if (::getrusage(RUSAGE_SELF, &usage) == -1)
+    return 0;
+  return usage.ru_maxrss;
+}
+
+double to_ms(PlyMetrics::clock_type::duration duration)
+{
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+// Write the size fields that the "run" and "summary" lines start with.
+void write_size(std::ostream& os, char const* type)
+{
+  os << "{\"type\":\"" << type << "\",\"board_x\":" << Size::board::x << ",\"board_y\":" << Size::board::y <<
+    ",\"Bx\":" << Size::Bx << ",\"By\":" << Size::By << ",\"Px\":" << Size::Px << ",\"Py\":" << Size::Py;
+}
+
+} // namespace
+
+PlyMetrics::PlyMetrics(std::filesystem::path const& filename, int number_of_threads) : os_(filename, std::ios::trunc)
+{
+  if (!os_)
+    THROW_ALERTE("Could not open [FILENAME] for writing", AIArgs("[FILENAME]", filename));
+  write_size(os_, "run");
+  os_ << ",\"threads\":" << number_of_threads << "}" << std::endl;
+}
+
+void PlyMetrics::begin_ply(int ply, Color to_move, size_t frontier_size)
+{
+  ply_ = ply;
+  to_move_ = to_move;
+  frontier_size_ = frontier_size;
+  counters_at_start_ = SolverCounters::totals();
+  std::tie(minor_faults_at_start_, major_faults_at_start_) = page_faults();
+  hardware_counters_at_start_ = hardware_counters_.read();
+  start_ = clock_type::now();
+}
+
+void PlyMetrics::end_ply(ChunkedRunTimes const& times)
+{
+  auto const wall_time = clock_type::now() - start_;
+  HardwareCounters::values_type const hardware_counters =
+    HardwareCounters::elapsed(hardware_counters_at_start_, hardware_counters_.read());
+  auto const [minor_faults, major_faults] = page_faults();
+  SolverCounters::values_type const counters = SolverCounters::totals();
+
+  os_ << "{\"type\":\"ply\",\"ply\":" << ply_ << ",\"to_move\":\"" << to_move_ << "\",\"frontier\":" << frontier_size_;
+  for (int counter = 0; counter < SolverCounters::number_of_counters; ++counter)
+    os_ << ",\"" << SolverCounters::name(static_cast<SolverCounters::counter_type>(counter)) << "\":" <<
+      (counters[counter] - counters_at_start_[counter]);
+  os_ << ",\"wall_ms\":" << to_ms(wall_time) << ",\"busy_ms\":[";
+  char const* separator = "";
+  for (auto busy_time : times.busy_time)
+  {
+    os_ << separator << to_ms(busy_time);
+    separator = ",";
+  }
+  os_ << "],\"minor_faults\":" << (minor_faults - minor_faults_at_start_) <<
+    ",\"major_faults\":" << (major_faults - major_faults_at_start_);
+  for (int i = 0; i < HardwareCounters::number_of_counters; ++i)
+  {
+    auto const counter = static_cast<HardwareCounters::counter_type>(i);
+    uint64_t const count = hardware_counters[counter];
+    hardware_counters_total_[counter] += count;
+    if (hardware_counters_.available(counter))
+      os_ << ",\"" << HardwareCounters::name(counter) << "\":" << count;
+  }
+  os_ << "}" << std::endl;
+}
+
+void PlyMetrics::end_run(Summary const& summary)
+{
+  write_size(os_, "summary");
+  os_ << ",\"layout\":\"" << (BlockSquareOrder::morton ? "morton" : "row_major") << "\"" <<
+    ",\"classify_s\":" << summary.classify_seconds << ",\"retrograde_s\":" << summary.retrograde_seconds <<
+    ",\"max_ply\":" << summary.max_ply << ",\"peak_rss_kb\":" << peak_rss_kb() <<
+    ",\"graph_bytes\":" << summary.graph_bytes << ",\"tablebase_bytes\":" << summary.tablebase_bytes;
+  for (int i = 0; i < HardwareCounters::number_of_counters; ++i)
+  {
+    auto const counter = static_cast<HardwareCounters::counter_type>(i);
+    if (hardware_counters_.available(counter))
+      os_ << ",\"" << HardwareCounters::name(counter) << "\":" << hardware_counters_total_[counter];
+  }
+  if (PositionCounts const* counts = summary.position_counts)
+    os_ << ",\"legal\":" << counts->legal << ",\"draws\":" << counts->draws << ",\"black_in_check\":" << counts->black_in_check <<
+      ",\"mates\":" << counts->mates << ",\"stalemates\":" << counts->stalemates;
+  os_ << "}" << std::endl;
+}
+
+} // namespace SIZE_NAMESPACE
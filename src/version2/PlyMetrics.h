@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Size.h"
+#include "HardwareCounters.h"
+#include "SolverCounters.h"
+#include "run_chunked.h"
+#include "../Color.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+
+inline namespace SIZE_NAMESPACE {
+
+// Per-ply metrics of the solver, written as JSON lines (see infchess2 --metrics=<filename>).
+//
+// The first line describes the run:
+//
+//   {"type":"run","board_x":8,"board_y":8,"Bx":4,"By":4,"Px":2,"Py":2,"threads":32}
+//
+// followed by one line per ply:
+//
+//   {"type":"ply","ply":7,"to_move":"white","frontier":1234,"parents_generated":...,"parents_accepted":...,
+//    "draw_skips":...,"cas_retries":...,"wall_ms":1.5,"busy_ms":[1.4,1.3,...],"minor_faults":12,"major_faults":0,
+//    "cache_references":...,"cache_misses":...,"dtlb_loads":...,"dtlb_load_misses":...}
+//
+// where frontier is the number of positions whose ply was determined in the previous ply, the counters
+// are those of SolverCounters.h, busy_ms is the time that each task had work (see ChunkedRunTimes),
+// the page faults are those of the whole process (getrusage) and the cache and TLB counters are those
+// of HardwareCounters.h (only the ones that are available; scaled if the PMU was multiplexed).
+//
+// The last line summarizes the whole solve (see bench_solve.sh):
+//
+//   {"type":"summary","board_x":8,"board_y":8,"Bx":4,"By":4,"Px":2,"Py":2,"layout":"row_major","classify_s":0.9,
+//    "retrograde_s":2.1,"max_ply":65,"peak_rss_kb":12345,"graph_bytes":1234567,"tablebase_bytes":123456,
+//    "cache_references":...,"cache_misses":...,"dtlb_loads":...,"dtlb_load_misses":...,"legal":402724,"draws":...,
+//    "black_in_check":...,"mates":...,"stalemates":...}
+//
+// where layout is the numbering of the squares of a block ("row_major" or "morton", see BlockSquareOrder),
+// the cache and TLB counters are the totals of all ply, the position counts are only present if the positions
+// were classified by this run (not when an existing Graph was reused) and graph_bytes is the size of the Info
+// file plus the memory of the AuxiliaryInfo.
+class PlyMetrics
+{
+ public:
+  using clock_type = std::chrono::steady_clock;
+
+  // The position counts of the classification (every canonical position also counts for its mirror image).
+  struct PositionCounts
+  {
+    size_t legal = 0;
+    size_t draws = 0;
+    size_t black_in_check = 0;
+    size_t mates = 0;
+    size_t stalemates = 0;
+  };
+
+  // The totals of a solve.
+  struct Summary
+  {
+    double classify_seconds;
+    double retrograde_seconds;
+    int max_ply;
+    size_t graph_bytes;
+    size_t tablebase_bytes;
+    PositionCounts const* position_counts;      // Null if the positions weren't classified.
+  };
+
+ private:
+  std::ofstream os_;
+  int ply_;
+  Color to_move_;
+  size_t frontier_size_;
+  clock_type::time_point start_;
+  SolverCounters::values_type counters_at_start_;
+  uint64_t minor_faults_at_start_;
+  uint64_t major_faults_at_start_;
+  HardwareCounters hardware_counters_;
+  HardwareCounters::Sample hardware_counters_at_start_;
+  HardwareCounters::values_type hardware_counters_total_{};
+
+ public:
+  // Create (truncate) `filename` and write the "run" line. Call this after creating the threads of the solver.
+  PlyMetrics(std::filesystem::path const& filename, int number_of_threads);
+
+  // Call this when the processing of the frontier of `ply` starts.
+  void begin_ply(int ply, Color to_move, size_t frontier_size);
+  // Call this when the processing of the frontier is finished; `times` are the accumulated times of the tasks of this ply.
+  void end_ply(ChunkedRunTimes const& times);
+  // Call this once the table was exported; writes the "summary" line.
+  void end_run(Summary const& summary);
+};
+
+} // namespace SIZE_NAMESPACE
@@ -0,0 +1,30 @@
+#include "sys.h"
+#include "ProbeRing.h"
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "debug.h"
+
+namespace probe_ring {
+
+std::string segment_name(int board_size_x, int board_size_y)
+{
+  return "/infchessKRvK-" + std::to_string(board_size_x) + "x" + std::to_string(board_size_y);
+}
+
+// The futexes are not FUTEX_PRIVATE_FLAG because the words are in memory that is shared between processes.
+
+void futex_wait(std::atomic<uint32_t>& word, uint32_t expected)
+{
+  // Returns immediately with EAGAIN if the word no longer contains `expected`, and might return spuriously (EINTR);
+  // the caller checks its condition again in both cases.
+  ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, nullptr, nullptr, 0);
+}
+
+void futex_wake(std::atomic<uint32_t>& word)
+{
+  ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+} // namespace probe_ring
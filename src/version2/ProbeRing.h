@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Uncompressed.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// The shared memory probe interface of mmap_server, for clients on the same host.
+//
+// mmap_server creates a POSIX shared memory object (see segment_name) that contains a fixed number of
+// channels. A client claims a channel (see ProbeRingClient) and then uses it as a single-producer,
+// single-consumer ring of slots:
+//
+//   - The client writes boards into the slots [submitted, submitted + n) and then advances `submitted`.
+//   - The server writes the two UncompressedInfo of every submitted slot into that same slot and then
+//     advances `completed`.
+//   - The client reads the results in place and only reuses a slot after it consumed its result.
+//
+// Neither side copies the data and, as long as both sides are busy, no system calls are made: a side only
+// blocks in futex_wait after spinning for a while, and announces that with a flag, so that the other side
+// knows that it has to call futex_wake.
+//
+// Every server thread serves the channels whose index modulo the number of server threads is equal to its
+// own index, and has its own Doorbell that clients ring when the thread is sleeping.
+namespace probe_ring {
+
+inline constexpr uint32_t version = 1;
+inline constexpr uint32_t number_of_channels = 64;
+inline constexpr uint32_t ring_size = 4096;             // The number of slots per channel; a power of two.
+inline constexpr uint32_t max_server_threads = 16;
+inline constexpr char magic[8] = { 'K', 'R', 'v', 'K', 'r', 'i', 'n', 'g' };
+
+static_assert((ring_size & (ring_size - 1)) == 0, "ring_size must be a power of two.");
+static_assert(std::atomic<uint32_t>::is_always_lock_free && sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+    "The futex words must be plain 32-bit integers.");
+
+struct Slot
+{
+  UncompressedBoard board;                      // Written by the client.
+  uint16_t padding;
+  UncompressedInfo info[2];                     // Written by the server: black to move and white to move.
+};
+
+struct alignas(64) Channel
+{
+  std::atomic<uint32_t> owner;                  // The pid of the client that uses this channel, or zero.
+  alignas(64) std::atomic<uint32_t> submitted;  // The number of boards submitted by the client (wraps around).
+  alignas(64) std::atomic<uint32_t> completed;  // The number of boards answered by the server (wraps around); the futex word of the client.
+  std::atomic<uint32_t> client_waiting;         // Set while the client is (about to be) blocked on `completed`.
+  alignas(64) Slot slots[ring_size];
+};
+
+struct alignas(64) Doorbell
+{
+  std::atomic<uint32_t> sequence;               // Incremented by clients to wake up the server thread; its futex word.
+  std::atomic<uint32_t> server_waiting;         // Set while the server thread is (about to be) blocked on `sequence`.
+};
+
+struct Segment
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t board_size_x;
+  uint32_t board_size_y;
+  uint32_t number_of_server_threads;
+  Doorbell doorbells[max_server_threads];
+  Channel channels[number_of_channels];
+};
+
+// The name of the shared memory object of the server of a board_size_x by board_size_y board.
+std::string segment_name(int board_size_x, int board_size_y);
+
+// Block while `word` contains `expected` (or until woken up). Works across processes.
+void futex_wait(std::atomic<uint32_t>& word, uint32_t expected);
+
+// Wake up all threads that are blocked in futex_wait on `word`.
+void futex_wake(std::atomic<uint32_t>& word);
+
+// Tell the CPU that we're spinning.
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+
+} // namespace probe_ring
@@ -0,0 +1,144 @@
+#include "sys.h"
+#include "ProbeRingClient.h"
+#include "utils/AIAlert.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "debug.h"
+
+using namespace probe_ring;
+
+ProbeRingClient::ProbeRingClient(int board_size_x, int board_size_y) : channel_(nullptr)
+{
+  std::string const name = segment_name(board_size_x, board_size_y);
+  int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+  if (fd == -1)
+    THROW_ALERTE("shm_open(\"[NAME]\") failed (is mmap_server running?)", AIArgs("[NAME]", name));
+  struct stat st;
+  if (::fstat(fd, &st) == -1 || static_cast<size_t>(st.st_size) < sizeof(Segment))
+  {
+    ::close(fd);
+    THROW_ALERT("The shared memory object \"[NAME]\" has the wrong size.", AIArgs("[NAME]", name));
+  }
+  void* mapped = ::mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED)
+    THROW_ALERTE("mmap() failed");
+  segment_ = static_cast<Segment*>(mapped);
+
+  // The server writes the magic last.
+  bool const initialized = std::memcmp(segment_->magic, probe_ring::magic, sizeof(probe_ring::magic)) == 0;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (!initialized || segment_->version != probe_ring::version ||
+      segment_->board_size_x != static_cast<uint32_t>(board_size_x) || segment_->board_size_y != static_cast<uint32_t>(board_size_y))
+  {
+    ::munmap(segment_, sizeof(Segment));
+    THROW_ALERT("The shared memory object \"[NAME]\" is not compatible.", AIArgs("[NAME]", name));
+  }
+
+  // Claim a free channel, or one whose owner no longer exists.
+  uint32_t const pid = ::getpid();
+  for (uint32_t c = 0; c < number_of_channels && !channel_; ++c)
+  {
+    Channel& channel = segment_->channels[c];
+    uint32_t owner = channel.owner.load(std::memory_order_relaxed);
+    if (owner != 0 && (::kill(owner, 0) == 0 || errno != ESRCH))
+      continue;
+    if (channel.owner.compare_exchange_strong(owner, pid, std::memory_order_acquire))
+    {
+      channel_ = &channel;
+      doorbell_ = &segment_->doorbells[c % segment_->number_of_server_threads];
+    }
+  }
+  if (!channel_)
+  {
+    ::munmap(segment_, sizeof(Segment));
+    THROW_ALERT("All [N] channels of \"[NAME]\" are in use.", AIArgs("[N]", number_of_channels)("[NAME]", name));
+  }
+
+  // A previous owner might have left boards that are still being answered.
+  submitted_ = channel_->submitted.load(std::memory_order_relaxed);
+  consumed_ = channel_->completed.load(std::memory_order_acquire);
+  wait_for(outstanding());
+  consume(outstanding());
+}
+
+ProbeRingClient::~ProbeRingClient()
+{
+  // Wait for outstanding results, so that the next owner starts with an idle channel.
+  wait_for(outstanding());
+  channel_->owner.store(0, std::memory_order_release);
+  ::munmap(segment_, sizeof(Segment));
+}
+
+void ProbeRingClient::submit(uint32_t count)
+{
+  ASSERT(count <= free_slots());
+  submitted_ += count;
+  channel_->submitted.store(submitted_, std::memory_order_release);
+  // Either the server sees the new value of submitted, or we see that it is waiting.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (doorbell_->server_waiting.load(std::memory_order_relaxed))
+  {
+    doorbell_->sequence.fetch_add(1, std::memory_order_relaxed);
+    futex_wake(doorbell_->sequence);
+  }
+}
+
+void ProbeRingClient::wait_for(uint32_t count)
+{
+  for (int round = 0;; ++round)
+  {
+    uint32_t completed = channel_->completed.load(std::memory_order_acquire);
+    if (completed - consumed_ >= count)
+      return;
+    if (round < spin_rounds)
+    {
+      cpu_relax();
+      continue;
+    }
+    channel_->client_waiting.store(1, std::memory_order_relaxed);
+    // Either the server sees client_waiting, or we see its new value of completed.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    completed = channel_->completed.load(std::memory_order_acquire);
+    if (completed - consumed_ < count)
+      futex_wait(channel_->completed, completed);
+    channel_->client_waiting.store(0, std::memory_order_relaxed);
+    round = 0;
+  }
+}
+
+void ProbeRingClient::probe(UncompressedBoard const* boards, size_t number_of_boards, UncompressedInfo* infos)
+{
+  ASSERT(outstanding() == 0);
+  size_t next_board = 0;        // The next board to submit.
+  size_t next_result = 0;       // The next result to read.
+  while (next_result < number_of_boards)
+  {
+    // Keep the ring filled.
+    uint32_t const count = std::min(static_cast<size_t>(free_slots()), number_of_boards - next_board);
+    if (count > 0)
+    {
+      for (uint32_t i = 0; i < count; ++i)
+        board(i) = boards[next_board + i];
+      submit(count);
+      next_board += count;
+    }
+    // Read at least one result, and all that are already available.
+    wait_for(1);
+    uint32_t const available = channel_->completed.load(std::memory_order_acquire) - consumed_;
+    for (uint32_t i = 0; i < available; ++i)
+    {
+      UncompressedInfo const* info = channel_->slots[(consumed_ + i) & (ring_size - 1)].info;
+      infos[2 * next_result] = info[0];
+      infos[2 * next_result + 1] = info[1];
+      ++next_result;
+    }
+    consume(available);
+  }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "ProbeRing.h"
+#include <cstddef>
+
+// The client side of the shared memory probe interface (see ProbeRing.h).
+//
+// Attaches to the shared memory object of the mmap_server that serves a board_size_x by board_size_y board
+// and claims a free channel. The results of the boards are returned in the order that the boards were submitted.
+//
+// The zero-copy interface:
+//
+//   uint32_t n = std::min(count, client.free_slots());
+//   for (uint32_t i = 0; i < n; ++i)
+//     client.board(i) = ...;                   // Write directly into the shared slots.
+//   client.submit(n);
+//   ...
+//   UncompressedInfo const* infos = client.result(0);  // Wait for the oldest result; infos[0] and infos[1].
+//   ...
+//   client.consume(1);                         // The slot may be reused.
+//
+// An object of this class may only be used by one thread at a time.
+class ProbeRingClient
+{
+ public:
+  // The number of times that we check for results before going to sleep.
+  static constexpr int spin_rounds = 4096;
+
+ private:
+  probe_ring::Segment* segment_;
+  probe_ring::Channel* channel_;
+  probe_ring::Doorbell* doorbell_;              // The doorbell of the server thread that serves our channel.
+  uint32_t submitted_;                          // Our copy of channel_->submitted.
+  uint32_t consumed_;                           // The number of results that were consumed.
+
+ public:
+  ProbeRingClient(int board_size_x, int board_size_y);
+  ~ProbeRingClient();
+
+  ProbeRingClient(ProbeRingClient const&) = delete;
+  ProbeRingClient& operator=(ProbeRingClient const&) = delete;
+
+  // The number of slots that can be filled before calling submit.
+  uint32_t free_slots() const { return probe_ring::ring_size - (submitted_ - consumed_); }
+
+  // The slot of the n-th board that will be submitted next (n < free_slots()).
+  UncompressedBoard& board(uint32_t n)
+  {
+    return channel_->slots[(submitted_ + n) & (probe_ring::ring_size - 1)].board;
+  }
+
+  // Submit the first `count` boards that were written with board().
+  void submit(uint32_t count);
+
+  // The number of submitted boards whose result wasn't consumed yet.
+  uint32_t outstanding() const { return submitted_ - consumed_; }
+
+  // Wait until the n-th oldest not consumed result is available (n < outstanding()) and return it.
+  UncompressedInfo const* result(uint32_t n)
+  {
+    wait_for(n + 1);
+    return channel_->slots[(consumed_ + n) & (probe_ring::ring_size - 1)].info;
+  }
+
+  // Release the `count` oldest results.
+  void consume(uint32_t count) { consumed_ += count; }
+
+  // Convenience function: look up `number_of_boards` boards and write their results to infos[2 * i] (black to move)
+  // and infos[2 * i + 1] (white to move). The work is pipelined through the ring.
+  void probe(UncompressedBoard const* boards, size_t number_of_boards, UncompressedInfo* infos);
+
+ private:
+  // Wait until at least `count` results after consumed_ are available.
+  void wait_for(uint32_t count);
+};
@@ -0,0 +1,148 @@
+#include "sys.h"
+#include "ProbeRingServer.h"
+#include "Tablebase.h"
+#include "answer_query.h"
+#include "utils/AIAlert.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "debug.h"
+
+inline namespace SIZE_NAMESPACE {
+
+using namespace probe_ring;
+
+ProbeRingServer::ProbeRingServer(Tablebase const& tablebase, int number_of_threads) :
+  tablebase_(tablebase), name_(segment_name(Size::board::x, Size::board::y)), stop_(false)
+{
+  number_of_threads = std::clamp(number_of_threads, 1, static_cast<int>(max_server_threads));
+
+  // Clients that are still attached to an old segment can't be served anymore; start with a fresh one.
+  ::shm_unlink(name_.c_str());
+  int fd = ::shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd == -1)
+    THROW_ALERTE("shm_open(\"[NAME]\") failed", AIArgs("[NAME]", name_));
+  // Zero initialized.
+  if (::ftruncate(fd, sizeof(Segment)) == -1)
+  {
+    ::close(fd);
+    ::shm_unlink(name_.c_str());
+    THROW_ALERTE("ftruncate() failed");
+  }
+  void* mapped = ::mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED)
+  {
+    ::shm_unlink(name_.c_str());
+    THROW_ALERTE("mmap() failed");
+  }
+  segment_ = static_cast<Segment*>(mapped);
+
+  segment_->version = probe_ring::version;
+  segment_->board_size_x = Size::board::x;
+  segment_->board_size_y = Size::board::y;
+  segment_->number_of_server_threads = number_of_threads;
+  // Clients check the magic last.
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(segment_->magic, probe_ring::magic, sizeof(segment_->magic));
+
+  for (int t = 0; t < number_of_threads; ++t)
+    threads_.emplace_back([this, t]{ main(t); });
+}
+
+ProbeRingServer::~ProbeRingServer()
+{
+  stop_ = true;
+  for (uint32_t t = 0; t < threads_.size(); ++t)
+  {
+    segment_->doorbells[t].sequence.fetch_add(1);
+    futex_wake(segment_->doorbells[t].sequence);
+  }
+  for (std::thread& thread : threads_)
+    thread.join();
+  ::munmap(segment_, sizeof(Segment));
+  ::shm_unlink(name_.c_str());
+}
+
+bool ProbeRingServer::has_work(int thread_index) const
+{
+  for (uint32_t c = thread_index; c < number_of_channels; c += segment_->number_of_server_threads)
+  {
+    Channel const& channel = segment_->channels[c];
+    if (channel.submitted.load(std::memory_order_acquire) != channel.completed.load(std::memory_order_relaxed))
+      return true;
+  }
+  return false;
+}
+
+bool ProbeRingServer::serve_channels(int thread_index)
+{
+  bool did_work = false;
+  for (uint32_t c = thread_index; c < number_of_channels; c += segment_->number_of_server_threads)
+  {
+    Channel& channel = segment_->channels[c];
+    uint32_t const submitted = channel.submitted.load(std::memory_order_acquire);
+    uint32_t completed = channel.completed.load(std::memory_order_relaxed);
+    if (submitted == completed)
+      continue;
+    did_work = true;
+    // The client may only submit boards into free slots.
+    if (submitted - completed > ring_size)
+    {
+      Dout(dc::warning, "Channel " << c << " submitted more than ring_size boards; resetting it.");
+      channel.completed.store(submitted, std::memory_order_release);
+      continue;
+    }
+    // Answer at most max_batch boards at a time, so that the client can start reading the results.
+    uint32_t const end = completed + std::min(submitted - completed, max_batch);
+    for (; completed != end; ++completed)
+    {
+      Slot& slot = channel.slots[completed & (ring_size - 1)];
+      if (is_on_board(slot.board))
+        answer_query(tablebase_, slot.board, slot.info);
+      else
+        std::memset(slot.info, 0, sizeof(slot.info));
+    }
+    channel.completed.store(completed, std::memory_order_release);
+    // Either the client sees the new value of completed, or we see that it is waiting.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (channel.client_waiting.load(std::memory_order_relaxed))
+    {
+      channel.client_waiting.store(0, std::memory_order_relaxed);
+      futex_wake(channel.completed);
+    }
+  }
+  return did_work;
+}
+
+void ProbeRingServer::main(int thread_index)
+{
+  Doorbell& doorbell = segment_->doorbells[thread_index];
+  int idle_rounds = 0;
+  while (!stop_.load(std::memory_order_relaxed))
+  {
+    if (serve_channels(thread_index))
+    {
+      idle_rounds = 0;
+      continue;
+    }
+    if (++idle_rounds < spin_rounds)
+    {
+      cpu_relax();
+      continue;
+    }
+    // Go to sleep until a client rings the doorbell.
+    uint32_t const sequence = doorbell.sequence.load(std::memory_order_relaxed);
+    doorbell.server_waiting.store(1, std::memory_order_relaxed);
+    // Either the clients see server_waiting, or we see their new value of submitted.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!has_work(thread_index) && !stop_.load(std::memory_order_relaxed))
+      futex_wait(doorbell.sequence, sequence);
+    doorbell.server_waiting.store(0, std::memory_order_relaxed);
+    idle_rounds = 0;
+  }
+}
+
+} // namespace SIZE_NAMESPACE
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Size.h"
+#include "ProbeRing.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+inline namespace SIZE_NAMESPACE {
+
+class Tablebase;
+
+// The server side of the shared memory probe interface (see ProbeRing.h).
+//
+// Creates (or replaces) the shared memory object and starts `number_of_threads` threads that answer the
+// boards that clients submit. The object is removed again by the destructor.
+class ProbeRingServer
+{
+ public:
+  // The number of times that a thread checks its channels before it goes to sleep.
+  static constexpr int spin_rounds = 4096;
+  // The maximum number of boards that are answered before `completed` is advanced.
+  static constexpr uint32_t max_batch = 256;
+
+ private:
+  Tablebase const& tablebase_;
+  std::string name_;
+  probe_ring::Segment* segment_;
+  std::atomic<bool> stop_;
+  std::vector<std::thread> threads_;
+
+ public:
+  ProbeRingServer(Tablebase const& tablebase, int number_of_threads);
+  ~ProbeRingServer();
+
+  // Accessor.
+  std::string const& name() const { return name_; }
+
+ private:
+  void main(int thread_index);
+  // Answer the pending boards of the channels of `thread_index`. Returns false if there was nothing to do.
+  bool serve_channels(int thread_index);
+  // Returns true if any channel of `thread_index` has pending boards.
+  bool has_work(int thread_index) const;
+};
+
+} // namespace SIZE_NAMESPACE
@@ -0,0 +1,173 @@
+#include "sys.h"
+#include "Prober.h"
+#include "Tablebase.h"
+#include <climits>
+#include "debug.h"
+
+namespace infchess_probe {
+
+class Prober::Table : public Tablebase
+{
+ public:
+  using Tablebase::Tablebase;
+};
+
+namespace {
+
+bool is_on_board(Square square)
+{
+  return square.x < Size::board::x && square.y < Size::board::y;
+}
+
+Board to_board(Position const& position)
+{
+  return {{position.black_king.x, position.black_king.y},
+          {position.white_king.x, position.white_king.y},
+          {position.white_rook.x, position.white_rook.y}};
+}
+
+ProbeResult to_result(Classification classification)
+{
+  ProbeResult result{Outcome::illegal, false, -1};
+  if (!classification.is_legal())
+    return result;
+  result.check = classification.is_check();
+  result.ply = classification.ply();
+  if (classification.is_mate())
+    result.outcome = Outcome::mate;
+  else if (classification.is_stalemate())
+    result.outcome = Outcome::stalemate;
+  else if (result.ply >= 0)
+    result.outcome = Outcome::mate_in;
+  else
+    result.outcome = Outcome::draw;
+  return result;
+}
+
+Square to_square(int x, int y)
+{
+  return {static_cast<uint8_t>(x), static_cast<uint8_t>(y)};
+}
+
+// Returns the move that leads from `board` to `child`.
+Move get_move(Board board, Board child)
+{
+  if (board.black_king().coordinates() != child.black_king().coordinates())
+    return {Piece::black_king, to_square(board.black_king().x_coord(), board.black_king().y_coord()),
+                               to_square(child.black_king().x_coord(), child.black_king().y_coord())};
+  if (board.white_king().coordinates() != child.white_king().coordinates())
+    return {Piece::white_king, to_square(board.white_king().x_coord(), board.white_king().y_coord()),
+                               to_square(child.white_king().x_coord(), child.white_king().y_coord())};
+  return {Piece::white_rook, to_square(board.white_rook().x_coord(), board.white_rook().y_coord()),
+                             to_square(child.white_rook().x_coord(), child.white_rook().y_coord())};
+}
+
+template<color_type to_move>
+size_t best_moves(Tablebase const& tablebase, Board board, Move* moves_out, size_t capacity)
+{
+  if (!tablebase.get_classification<to_move>(board).is_legal())
+    return 0;
+  // Black just took the rook: that is a legal draw, but there is no rook to generate moves for.
+  if (to_move == white && ::Square{board.black_king()} == ::Square{board.white_rook()})
+    return 0;
+
+  constexpr color_type child_to_move = to_move == black ? white : black;
+  Board::neighbors_type children;
+  int const number_of_children = board.generate_neighbors<Board::children, to_move>(children);
+
+  // The value of a child is the number of ply till mate, where "no forced mate" is the largest value.
+  // White minimizes the value, black maximizes it.
+  std::array<int, Board::max_degree> values;
+  int best_value = to_move == white ? INT_MAX : -1;
+  for (int i = 0; i < number_of_children; ++i)
+  {
+    Classification const classification = tablebase.get_classification<child_to_move>(children[i]);
+    if (!classification.is_legal())
+    {
+      values[i] = -2;           // Never optimal.
+      continue;
+    }
+    values[i] = classification.ply() >= 0 ? classification.ply() : INT_MAX;
+    best_value = to_move == white ? std::min(best_value, values[i]) : std::max(best_value, values[i]);
+  }
+
+  size_t number_of_moves = 0;
+  for (int i = 0; i < number_of_children; ++i)
+  {
+    if (values[i] != best_value)
+      continue;
+    if (number_of_moves < capacity)
+      moves_out[number_of_moves] = get_move(board, children[i]);
+    ++number_of_moves;
+  }
+  return number_of_moves;
+}
+
+} // namespace
+
+Prober::Prober(std::filesystem::path const& data_directory) :
+  tablebase_(std::make_unique<Table>(Tablebase::filename(data_directory)))
+{
+}
+
+Prober::~Prober() = default;
+
+//static
+int Prober::board_size_x() noexcept
+{
+  return Size::board::x;
+}
+
+//static
+int Prober::board_size_y() noexcept
+{
+  return Size::board::y;
+}
+
+ProbeResult Prober::probe(Position const& position) const noexcept
+{
+  if (!is_on_board(position.black_king) || !is_on_board(position.white_king) || !is_on_board(position.white_rook))
+    return {Outcome::illegal, false, -1};
+  Board const board = to_board(position);
+  return to_result(position.to_move == ToMove::black ?
+      tablebase_->get_classification<black>(board) : tablebase_->get_classification<white>(board));
+}
+
+void Prober::probe(Position const* positions, size_t count, ProbeResult* results) const noexcept
+{
+  // The number of positions that are looked up ahead, so that their cache misses overlap.
+  constexpr size_t prefetch_distance = 8;
+  for (size_t i = 0; i < count; ++i)
+  {
+    if (i + prefetch_distance < count)
+    {
+      Position const& ahead = positions[i + prefetch_distance];
+      if (is_on_board(ahead.black_king) && is_on_board(ahead.white_king) && is_on_board(ahead.white_rook))
+      {
+        if (ahead.to_move == ToMove::black)
+          tablebase_->prefetch<black>(to_board(ahead));
+        else
+          tablebase_->prefetch<white>(to_board(ahead));
+      }
+    }
+    results[i] = probe(positions[i]);
+  }
+}
+
+size_t Prober::best_moves(Position const& position, Move* moves_out, size_t capacity) const noexcept
+{
+  if (!is_on_board(position.black_king) || !is_on_board(position.white_king) || !is_on_board(position.white_rook))
+    return 0;
+  Board const board = to_board(position);
+  return position.to_move == ToMove::black ?
+    infchess_probe::best_moves<black>(*tablebase_, board, moves_out, capacity) :
+    infchess_probe::best_moves<white>(*tablebase_, board, moves_out, capacity);
+}
+
+void Prober::best_moves(Position const* positions, size_t count, Move* moves_out, size_t capacity, size_t* number_of_moves_out) const noexcept
+{
+  for (size_t i = 0; i < count; ++i)
+    number_of_moves_out[i] = best_moves(positions[i], moves_out + i * capacity, capacity);
+}
+
+} // namespace infchess_probe
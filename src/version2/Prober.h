@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+// In-process, read-only access to a solved table (the library infchess_probe).
+//
+// This header only uses plain types, so that programs that use it don't depend on the internal
+// representation of boards and tables. A Prober maps data_directory/tablebase.dtm (see Tablebase.h)
+// once; after that no function allocates memory or makes system calls (apart from page faults).
+//
+// The library is compiled for one size (infchess_probe_<BXxBYxPXxPY>, one for every size in INFCHESS_SIZES);
+// opening a table that was written for a different size throws AIAlert::Error. A program can link only one of
+// these libraries: infchess_probe::Prober has the same symbols in all of them, so the linker would silently
+// use the first one for every size.
+namespace infchess_probe {
+
+enum class ToMove : uint8_t
+{
+  black,
+  white
+};
+
+struct Square
+{
+  uint8_t x;
+  uint8_t y;
+};
+
+struct Position
+{
+  Square black_king;
+  Square white_king;
+  Square white_rook;
+  ToMove to_move;
+};
+
+enum class Outcome : uint8_t
+{
+  illegal,              // The position can not occur (or a coordinate is outside the board).
+  mate,                 // Black is mate.
+  stalemate,            // Black is stalemate.
+  draw,                 // White can not force mate (for example, because black can take the rook).
+  mate_in               // White mates in `ply` ply (with best play by both sides).
+};
+
+struct ProbeResult
+{
+  Outcome outcome;
+  bool check;           // Black is in check.
+  int16_t ply;          // The number of ply till mate (zero if mate), or -1 if there is no forced mate.
+};
+
+enum class Piece : uint8_t
+{
+  black_king,
+  white_king,
+  white_rook
+};
+
+struct Move
+{
+  Piece piece;
+  Square from;
+  Square to;
+};
+
+class Prober
+{
+ private:
+  class Table;                                  // The Tablebase (which is declared in the namespace of the size, see Size.h).
+  std::unique_ptr<Table const> tablebase_;
+
+ public:
+  // Map the table in `data_directory` (the directory returned by Graph::data_directory).
+  explicit Prober(std::filesystem::path const& data_directory);
+  ~Prober();
+
+  // The size of the board that this library was compiled for.
+  static int board_size_x() noexcept;
+  static int board_size_y() noexcept;
+
+  // Look up a single position.
+  ProbeResult probe(Position const& position) const noexcept;
+
+  // Look up `count` positions: results[i] is the result of positions[i].
+  void probe(Position const* positions, size_t count, ProbeResult* results) const noexcept;
+
+  // Write the moves that are optimal for the side to move to `moves_out` (at most `capacity` moves) and return the
+  // number of optimal moves (which can be larger than `capacity`). White plays the moves that mate fastest, black
+  // those that delay mate the longest or that lead to a draw; if black can take the rook then that king move is one
+  // of the (drawing) best moves. If the position is a draw for white this returns all legal moves, unless the rook
+  // was taken: then, like for a position that is not legal, it returns zero.
+  size_t best_moves(Position const& position, Move* moves_out, size_t capacity) const noexcept;
+
+  // Same for `count` positions. moves_out[i * capacity] .. moves_out[i * capacity + capacity - 1] are the moves of
+  // positions[i], and number_of_moves_out[i] the return value of best_moves for it.
+  void best_moves(Position const* positions, size_t count, Move* moves_out, size_t capacity, size_t* number_of_moves_out) const noexcept;
+};
+
+} // namespace infchess_probe
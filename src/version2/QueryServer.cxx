@@ -0,0 +1,488 @@
+#include "sys.h"
+#include "QueryServer.h"
+#include "Tablebase.h"
+#include "Uncompressed.h"
+#include "answer_query.h"
+#include "utils/AIAlert.h"
+#include "utils/at_scope_end.h"
+#include <array>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "debug.h"
+
+inline namespace SIZE_NAMESPACE {
+
+// The state of one client connection. Only accessed by the Worker that owns it.
+class QueryServer::Connection
+{
+ public:
+  // The maximum number of bytes read at once; after that other connections get a turn first.
+  static constexpr size_t read_chunk_size = 65536;
+  // Stop reading new requests while more than this number of bytes of replies are waiting to be sent.
+  static constexpr size_t max_pending_output = 1024 * 1024;
+
+ private:
+  using clock_type = LatencyHistogram::clock_type;
+
+  enum class Protocol { unknown, framed, unframed };
+
+  // A request whose reply is (partially) in output_.
+  struct PendingReply
+  {
+    size_t end;                                 // The offset in output_ just past the last byte of the reply.
+    clock_type::time_point start;               // When the request was received.
+  };
+
+  int fd_;
+  Protocol protocol_;
+  std::vector<char> input_;                     // Received bytes that weren't processed yet (less than one header or record).
+  uint32_t remaining_boards_;                   // The number of boards of the current (framed) request that still have to be received.
+  clock_type::time_point request_start_;        // When the header of the current request was received.
+  std::vector<char> output_;                    // Replies that weren't sent yet; reused for the whole connection.
+  size_t output_sent_;                          // The number of bytes of output_ that were already sent.
+  std::deque<PendingReply> pending_replies_;    // The requests whose reply is not completely sent yet, in order.
+
+ public:
+  Connection(int fd) : fd_(fd), protocol_(Protocol::unknown), remaining_boards_(0), output_sent_(0) { }
+  ~Connection() { ::close(fd_); }
+
+  // Returns the epoll events that this connection is waiting for.
+  uint32_t interest() const
+  {
+    size_t const pending_output = output_.size() - output_sent_;
+    return (pending_output > 0 ? uint32_t{EPOLLOUT} : 0) | (pending_output < max_pending_output ? uint32_t{EPOLLIN} : 0);
+  }
+
+  // Called when the socket is readable. Returns false if the connection must be closed.
+  bool on_readable(Tablebase const& tablebase, LatencyHistogram& latencies);
+
+  // Called when the socket is writable. Returns false if the connection must be closed.
+  bool on_writable(LatencyHistogram& latencies) { return flush(latencies); }
+
+ private:
+  // Process as much of input_ as possible. Returns false if the input isn't valid.
+  bool process(Tablebase const& tablebase, clock_type::time_point now);
+  // Append the replies for `number_of_boards` boards starting at `boards`. Returns false if a board isn't valid.
+  bool answer(Tablebase const& tablebase, char const* boards, size_t number_of_boards);
+  // Send as much of output_ as possible.
+  bool flush(LatencyHistogram& latencies);
+
+  template<typename T>
+  void append(T const& object)
+  {
+    size_t const size = output_.size();
+    output_.resize(size + sizeof(T));
+    std::memcpy(output_.data() + size, &object, sizeof(T));
+  }
+};
+
+bool QueryServer::Connection::on_readable(Tablebase const& tablebase, LatencyHistogram& latencies)
+{
+  size_t const old_size = input_.size();
+  input_.resize(old_size + read_chunk_size);
+  ssize_t const bytes_received = ::recv(fd_, input_.data() + old_size, read_chunk_size, 0);
+  input_.resize(old_size + std::max(bytes_received, ssize_t{0}));
+  if (bytes_received == 0)
+  {
+    Dout(dc::notice, "Client disconnected, fd=" << fd_);
+    return false;
+  }
+  if (bytes_received == -1)
+  {
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+      return true;
+    Dout(dc::warning, "recv() error: " << strerror(errno));
+    return false;
+  }
+  return process(tablebase, clock_type::now()) && flush(latencies);
+}
+
+bool QueryServer::Connection::process(Tablebase const& tablebase, clock_type::time_point now)
+{
+  if (protocol_ == Protocol::unknown)
+  {
+    if (input_.size() < sizeof(uint32_t) && static_cast<uint8_t>(input_[0]) == (QueryHeader::query_magic & 0xff))
+      return true;              // Wait for the rest of the magic.
+    uint32_t magic = 0;
+    if (input_.size() >= sizeof(uint32_t))
+      std::memcpy(&magic, input_.data(), sizeof(magic));
+    protocol_ = magic == QueryHeader::query_magic ? Protocol::framed : Protocol::unframed;
+  }
+
+  char const* in = input_.data();
+  char const* const in_end = in + input_.size();
+
+  if (protocol_ == Protocol::unframed)
+  {
+    // Every recv() that completes at least one board is a request.
+    size_t const number_of_boards = (in_end - in) / sizeof(UncompressedBoard);
+    if (number_of_boards > 0)
+    {
+      if (!answer(tablebase, in, number_of_boards))
+        return false;
+      in += number_of_boards * sizeof(UncompressedBoard);
+      pending_replies_.push_back({output_.size(), now});
+    }
+  }
+  else
+  {
+    for (;;)
+    {
+      if (remaining_boards_ == 0)
+      {
+        // Start a new request.
+        if (static_cast<size_t>(in_end - in) < sizeof(QueryHeader))
+          break;
+        QueryHeader query_header;
+        std::memcpy(&query_header, in, sizeof(QueryHeader));
+        in += sizeof(QueryHeader);
+        if (query_header.magic != QueryHeader::query_magic)
+        {
+          Dout(dc::warning, "Received a request with a wrong magic, fd=" << fd_);
+          return false;
+        }
+        append(ReplyHeader{ReplyHeader::reply_magic, query_header.request_id, query_header.number_of_boards});
+        remaining_boards_ = query_header.number_of_boards;
+        request_start_ = now;
+      }
+      else
+      {
+        // Answer the boards of the current request that were received so far.
+        size_t const number_of_boards =
+          std::min(static_cast<size_t>(remaining_boards_), static_cast<size_t>(in_end - in) / sizeof(UncompressedBoard));
+        if (number_of_boards == 0)
+          break;
+        if (!answer(tablebase, in, number_of_boards))
+          return false;
+        in += number_of_boards * sizeof(UncompressedBoard);
+        remaining_boards_ -= number_of_boards;
+      }
+      if (remaining_boards_ == 0)
+        pending_replies_.push_back({output_.size(), request_start_});
+    }
+  }
+
+  // Keep the bytes of an incomplete header or record for the next recv().
+  input_.erase(input_.begin(), input_.begin() + (in - input_.data()));
+  return true;
+}
+
+bool QueryServer::Connection::answer(Tablebase const& tablebase, char const* boards, size_t number_of_boards)
+{
+  size_t const size = output_.size();
+  output_.resize(size + number_of_boards * 2 * sizeof(UncompressedInfo));
+  char* out = output_.data() + size;
+  for (size_t i = 0; i < number_of_boards; ++i)
+  {
+    UncompressedBoard uncompressed_board;
+    std::memcpy(&uncompressed_board, boards + i * sizeof(UncompressedBoard), sizeof(UncompressedBoard));
+    if (!is_on_board(uncompressed_board))
+    {
+      Dout(dc::warning, "Received a board with coordinates outside the board, fd=" << fd_);
+      return false;
+    }
+    // Black and white to move for each board.
+    UncompressedInfo infos[2];
+    answer_query(tablebase, uncompressed_board, infos);
+    std::memcpy(out, infos, sizeof(infos));
+    out += sizeof(infos);
+  }
+  Dout(dc::notice, "Processed " << number_of_boards << " board(s), fd=" << fd_);
+  return true;
+}
+
+bool QueryServer::Connection::flush(LatencyHistogram& latencies)
+{
+  while (output_sent_ < output_.size())
+  {
+    iovec iov{ output_.data() + output_sent_, output_.size() - output_sent_ };
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    ssize_t const bytes_sent = ::sendmsg(fd_, &message, MSG_NOSIGNAL);
+    if (bytes_sent == -1)
+    {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        break;                  // Wait till the socket is writable again.
+      Dout(dc::warning, "sendmsg() error: " << strerror(errno));
+      return false;
+    }
+    output_sent_ += bytes_sent;
+  }
+
+  // Record the latency of every request whose reply was sent completely.
+  clock_type::time_point const now = clock_type::now();
+  while (!pending_replies_.empty() && pending_replies_.front().end <= output_sent_)
+  {
+    latencies.record(now - pending_replies_.front().start);
+    pending_replies_.pop_front();
+  }
+
+  // Once everything is sent, start again at the beginning of the buffer (keeping its capacity).
+  if (output_sent_ == output_.size())
+  {
+    output_.clear();
+    output_sent_ = 0;
+  }
+  return true;
+}
+
+// A thread with its own epoll instance, serving a set of connections.
+class QueryServer::Worker
+{
+ private:
+  QueryServer& server_;
+  int epoll_fd_;
+  int wakeup_fd_;                               // An eventfd that is used to tell the thread about new connections (or to stop).
+  std::mutex mutex_;
+  std::vector<int> new_connections_;            // Protected by mutex_.
+  bool stop_;                                   // Protected by mutex_.
+  LatencyHistogram latencies_;
+  std::thread thread_;
+
+ public:
+  Worker(QueryServer& server);
+  ~Worker();
+
+  // Hand a (non-blocking) client socket to this worker. This function is thread-safe.
+  void add(int client_fd);
+
+  // Accessor.
+  LatencyHistogram const& latencies() const { return latencies_; }
+
+ private:
+  void wakeup();
+  void main();
+  bool take_new_connections(std::unordered_map<int, std::unique_ptr<Connection>>& connections);
+};
+
+QueryServer::Worker::Worker(QueryServer& server) : server_(server), stop_(false)
+{
+  epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd_ == -1)
+    THROW_ALERTE("epoll_create1() failed");
+  // The destructor isn't called if the constructor throws.
+  auto&& close_epoll_fd = at_scope_end([this]{ ::close(epoll_fd_); });
+  wakeup_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wakeup_fd_ == -1)
+    THROW_ALERTE("eventfd() failed");
+  auto&& close_wakeup_fd = at_scope_end([this]{ ::close(wakeup_fd_); });
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.fd = wakeup_fd_;
+  if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wakeup_fd_, &event) == -1)
+    THROW_ALERTE("epoll_ctl() failed");
+  thread_ = std::thread([this]{ main(); });
+  close_wakeup_fd.disarm();
+  close_epoll_fd.disarm();
+}
+
+QueryServer::Worker::~Worker()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wakeup();
+  thread_.join();
+  ::close(wakeup_fd_);
+  ::close(epoll_fd_);
+}
+
+void QueryServer::Worker::wakeup()
+{
+  uint64_t const one = 1;
+  [[maybe_unused]] ssize_t written = ::write(wakeup_fd_, &one, sizeof(one));
+}
+
+void QueryServer::Worker::add(int client_fd)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    new_connections_.push_back(client_fd);
+  }
+  wakeup();
+}
+
+bool QueryServer::Worker::take_new_connections(std::unordered_map<int, std::unique_ptr<Connection>>& connections)
+{
+  uint64_t count;
+  [[maybe_unused]] ssize_t bytes_read = ::read(wakeup_fd_, &count, sizeof(count));
+  std::vector<int> new_connections;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stop_)
+      return false;
+    new_connections.swap(new_connections_);
+  }
+  for (int client_fd : new_connections)
+  {
+    auto connection = std::make_unique<Connection>(client_fd);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = client_fd;
+    if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, client_fd, &event) == -1)
+    {
+      Dout(dc::warning, "epoll_ctl() failed: " << strerror(errno));
+      server_.number_of_connections_.fetch_sub(1, std::memory_order_relaxed);
+      continue;                 // This closes the connection.
+    }
+    connections.emplace(client_fd, std::move(connection));
+  }
+  return true;
+}
+
+void QueryServer::Worker::main()
+{
+  std::unordered_map<int, std::unique_ptr<Connection>> connections;
+  std::array<epoll_event, 64> events;
+
+  for (;;)
+  {
+    int const number_of_events = ::epoll_wait(epoll_fd_, events.data(), events.size(), -1);
+    if (number_of_events == -1)
+    {
+      if (errno == EINTR)
+        continue;
+      std::cerr << "epoll_wait() failed: " << strerror(errno) << std::endl;
+      break;
+    }
+    for (int i = 0; i < number_of_events; ++i)
+    {
+      int const fd = events[i].data.fd;
+      if (fd == wakeup_fd_)
+      {
+        if (!take_new_connections(connections))
+          return;               // Stop; this closes all connections.
+        continue;
+      }
+      Connection& connection = *connections.at(fd);
+      uint32_t const old_interest = connection.interest();
+      bool keep = true;
+      if ((events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) && (old_interest & EPOLLOUT))
+        keep = connection.on_writable(latencies_);
+      if (keep && (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) && (connection.interest() & EPOLLIN))
+        keep = connection.on_readable(server_.tablebase_, latencies_);
+      if (keep && connection.interest() != old_interest)
+      {
+        // Wait for the socket to become writable while a reply is pending, and stop
+        // reading new requests while too much output is pending.
+        epoll_event event{};
+        event.events = connection.interest();
+        event.data.fd = fd;
+        keep = ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &event) == 0;
+      }
+      if (!keep)
+      {
+        // Closing the fd also removes it from the epoll set.
+        connections.erase(fd);
+        server_.number_of_connections_.fetch_sub(1, std::memory_order_relaxed);
+      }
+    }
+  }
+}
+
+QueryServer::QueryServer(Tablebase const& tablebase, int port, int number_of_workers) :
+  tablebase_(tablebase), next_worker_(0), number_of_connections_(0)
+{
+  listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listen_fd_ == -1)
+    THROW_ALERTE("Failed to create socket");
+
+  // Allow reuse of address.
+  int opt = 1;
+  if (setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == -1)
+    THROW_ALERTE("setsockopt failed");
+
+  struct sockaddr_in server_addr;
+  std::memset(&server_addr, 0, sizeof(server_addr));
+  server_addr.sin_family = AF_INET;
+  server_addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+  server_addr.sin_port = htons(port);
+
+  if (bind(listen_fd_, (struct sockaddr*)&server_addr, sizeof(server_addr)) == -1)
+    THROW_ALERTE("Failed to bind socket to port [PORT]", AIArgs("[PORT]", port));
+
+  if (listen(listen_fd_, SOMAXCONN) == -1)
+    THROW_ALERTE("Failed to listen on socket");
+
+  for (int w = 0; w < number_of_workers; ++w)
+    workers_.push_back(std::make_unique<Worker>(*this));
+}
+
+QueryServer::~QueryServer()
+{
+  workers_.clear();
+  ::close(listen_fd_);
+}
+
+LatencyHistogram::Snapshot QueryServer::latencies() const
+{
+  LatencyHistogram::Snapshot snapshot;
+  for (auto const& worker : workers_)
+    worker->latencies().add_to(snapshot);
+  return snapshot;
+}
+
+void QueryServer::run(std::chrono::seconds report_interval)
+{
+  auto next_report = std::chrono::steady_clock::now() + report_interval;
+  uint64_t reported_requests = 0;
+
+  for (;;)
+  {
+    pollfd listen_pollfd{ listen_fd_, POLLIN, 0 };
+    auto const timeout = std::chrono::duration_cast<std::chrono::milliseconds>(next_report - std::chrono::steady_clock::now());
+    if (::poll(&listen_pollfd, 1, std::max(timeout.count(), decltype(timeout.count()){0})) == -1 && errno != EINTR)
+      THROW_ALERTE("poll() failed");
+
+    // Accept all pending connections.
+    for (;;)
+    {
+      int const client_fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (client_fd == -1)
+      {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+          Dout(dc::warning, "Failed to accept connection: " << strerror(errno));
+        break;
+      }
+      // Replies are small and should not wait for more data.
+      int nodelay = 1;
+      setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+      number_of_connections_.fetch_add(1, std::memory_order_relaxed);
+      Dout(dc::notice, "New client connected, fd=" << client_fd);
+      workers_[next_worker_]->add(client_fd);
+      next_worker_ = (next_worker_ + 1) % workers_.size();
+    }
+
+    if (std::chrono::steady_clock::now() >= next_report)
+    {
+      LatencyHistogram::Snapshot const snapshot = latencies();
+      if (snapshot.total != reported_requests)
+      {
+        std::cout << number_of_connections_.load(std::memory_order_relaxed) << " connections; ";
+        snapshot.print_on(std::cout);
+        std::cout << std::endl;
+        reported_requests = snapshot.total;
+      }
+      next_report += report_interval;
+    }
+  }
+}
+
+} // namespace SIZE_NAMESPACE
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Size.h"
+#include "LatencyHistogram.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+inline namespace SIZE_NAMESPACE {
+
+class Tablebase;
+
+// A TCP server that answers queries about the positions in a Tablebase.
+//
+// The calling thread of `run` accepts connections and hands them round-robin to a fixed number of
+// worker threads. Each worker serves all of its connections from its own epoll instance, using
+// non-blocking sockets, so that a slow client only delays itself. All workers share the same
+// (read-only) Tablebase.
+//
+// Clients use the framed protocol that is described in Uncompressed.h: any number of requests, each
+// with any number of boards, may be in flight on one connection. Boards are answered as soon as they are
+// received (a request doesn't have to be received completely first), and the replies are appended to a
+// per connection output buffer that is reused and sent with sendmsg(). While more than max_pending_output
+// bytes are waiting to be sent, the connection stops reading new requests.
+//
+// The time between receiving the header of a request and handing the last byte of its reply to the
+// kernel is recorded per worker in a LatencyHistogram.
+class QueryServer
+{
+ private:
+  class Connection;
+  class Worker;
+
+  Tablebase const& tablebase_;
+  int listen_fd_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  size_t next_worker_;
+  std::atomic<int> number_of_connections_;
+
+ public:
+  // Listen on localhost:`port` and start `number_of_workers` worker threads.
+  QueryServer(Tablebase const& tablebase, int port, int number_of_workers);
+  ~QueryServer();
+
+  // Accept connections forever. Every `report_interval` the latency percentiles are printed (if there were new requests).
+  [[noreturn]] void run(std::chrono::seconds report_interval);
+
+  // Returns the latencies of all requests handled so far.
+  LatencyHistogram::Snapshot latencies() const;
+};
+
+} // namespace SIZE_NAMESPACE
@@ -0,0 +1,42 @@
+#include "sys.h"
+#include "ScratchMemory.h"
+#include "utils/AIAlert.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "debug.h"
+
+ScratchMemory::ScratchMemory(size_t size, size_t budget, std::filesystem::path const& spill_filename) :
+  size_(size), anonymous_(budget == 0 || size <= budget)
+{
+  if (anonymous_)
+  {
+    Dout(dc::notice, "Using " << (size >> 20) << " MiB of anonymous memory.");
+    base_ = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base_ == MAP_FAILED)
+      THROW_ALERTE("mmap() of [SIZE] bytes of anonymous memory failed", AIArgs("[SIZE]", size));
+    return;
+  }
+
+  Dout(dc::notice, "Spilling " << (size >> 20) << " MiB to " << spill_filename << ".");
+  int const fd = ::open(spill_filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1)
+    THROW_ALERTE("Could not open [FILENAME] for writing", AIArgs("[FILENAME]", spill_filename));
+  // A new file of `size` bytes without any blocks: it reads as zeroes.
+  if (::ftruncate(fd, size) == -1)
+  {
+    ::close(fd);
+    THROW_ALERTE("ftruncate() of [FILENAME] failed", AIArgs("[FILENAME]", spill_filename));
+  }
+  base_ = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  // The mapping keeps the file alive; unlinking it now means that it is also removed when the process is killed.
+  std::filesystem::remove(spill_filename);
+  if (base_ == MAP_FAILED)
+    THROW_ALERTE("mmap() of [FILENAME] failed", AIArgs("[FILENAME]", spill_filename));
+}
+
+ScratchMemory::~ScratchMemory()
+{
+  ::munmap(base_, size_);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+// Zero initialized memory for data that is thrown away at the end of the process (the AuxiliaryInfo of the Graph).
+//
+// As long as the size doesn't exceed the budget this is anonymous memory: the kernel never writes it
+// back anywhere (other than to swap under memory pressure), and it can be mapped with huge pages.
+// Otherwise the memory is a shared mapping of a spill file, so that the kernel can evict it like
+// the Info; the file is unlinked as soon as it is mapped.
+class ScratchMemory
+{
+ private:
+  void* base_;
+  size_t size_;
+  bool anonymous_;
+
+ public:
+  // Map `size` bytes. If `budget` is non-zero and `size` exceeds it, use the file `spill_filename`.
+  ScratchMemory(size_t size, size_t budget, std::filesystem::path const& spill_filename);
+  ~ScratchMemory();
+
+  ScratchMemory(ScratchMemory const&) = delete;
+  ScratchMemory& operator=(ScratchMemory const&) = delete;
+
+  void* mapped_base() const { return base_; }
+  size_t mapped_size() const { return size_; }
+
+  // Returns true if the memory is anonymous; madvise(MADV_DONTNEED) would then zero it.
+  bool is_anonymous() const { return anonymous_; }
+};
@@ -127,25 +127,43 @@ concept RectangleSizeConcept = requires(T rectangle_size) {
   { RectangleSize{rectangle_size} } -> std::same_as<T>;
 };
 
+#if !(defined(SIZE_PX) && defined(SIZE_PY) && defined(SIZE_BX) && defined(SIZE_BY))
+#undef SIZE_BX
+#undef SIZE_BY
+#undef SIZE_PX
+#undef SIZE_PY
+#define SIZE_BX 8       // Width in squares of one "king block".
+#define SIZE_BY 8       // Height in square of one "king block".
+#define SIZE_PX 4
+#define SIZE_PY 4
+#endif
+
+// Everything that depends on Size is declared in an inline namespace whose name contains the size (size_BXxBYxPXxPY),
+// so that the code of more than one size can be linked into the same program (see SizeRegistry.h).
+#define SIZE_NAMESPACE_NAME2(bx, by, px, py) size_##bx##x##by##x##px##x##py
+#define SIZE_NAMESPACE_NAME(bx, by, px, py) SIZE_NAMESPACE_NAME2(bx, by, px, py)
+#define SIZE_NAMESPACE SIZE_NAMESPACE_NAME(SIZE_BX, SIZE_BY, SIZE_PX, SIZE_PY)
+
+inline namespace SIZE_NAMESPACE {
+
 struct Size
 {
  public:
-#if defined(SIZE_PX) && defined(SIZE_PY) && defined(SIZE_BX) && defined(SIZE_BY)
   static constexpr unsigned int Bx = SIZE_BX;
   static constexpr unsigned int By = SIZE_BY;
   static constexpr unsigned int Px = SIZE_PX;
   static constexpr unsigned int Py = SIZE_PY;
-#else
-  static constexpr unsigned int Bx = 8;         // Width in squares of one "king block".
-  static constexpr unsigned int By = 8;         // Height in square of one "king block".
-  static constexpr unsigned int Px = 4;
-  static constexpr unsigned int Py = 4;
-#endif
 
   static constexpr unsigned int board_size_x = Bx * Px;
   static constexpr unsigned int board_size_y = By * Py;
 
+  // If both the blocks and the board are square then every position has a mirror image (x <--> y)
+  // with the same classification and ply. In that case only one of the two is stored (see Board::is_canonical).
+  static constexpr bool diagonal_symmetry = Bx == By && Px == Py;
+
  public:
   using block = RectangleSize<Bx, By>;                          // Size information for a Block.
   using board = RectangleSize<board_size_x, board_size_y>;      // Size information for a Board.
 };
+
+} // namespace SIZE_NAMESPACE
@@ -0,0 +1,85 @@
+#include "sys.h"
+#include "SizeRegistry.h"
+#include "TablebaseHeader.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "debug.h"
+
+std::string SizeRegistry::Entry::name() const
+{
+  return std::to_string(Bx) + "x" + std::to_string(By) + "x" + std::to_string(Px) + "x" + std::to_string(Py);
+}
+
+SizeRegistry::Registration::Registration(unsigned int Bx, unsigned int By, unsigned int Px, unsigned int Py, entry_point_type entry_point)
+{
+  s_entries().push_back({Bx, By, Px, Py, entry_point});
+}
+
+//static
+SizeRegistry::Entry const* SizeRegistry::find(std::string_view name)
+{
+  auto entry = std::find_if(s_entries().begin(), s_entries().end(), [name](Entry const& entry){ return entry.name() == name; });
+  return entry == s_entries().end() ? nullptr : &*entry;
+}
+
+namespace {
+
+// Returns the size of the table in `filename` as "BXxBYxPXxPY", or an empty string if it can't be read.
+std::string read_tablebase_size(std::string_view filename)
+{
+  TablebaseHeader header;
+  std::ifstream file{std::string{filename}, std::ios::binary};
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, TablebaseHeader::expected_magic, sizeof(header.magic)) != 0)
+    return {};
+  return SizeRegistry::Entry{header.Bx, header.By, header.Px, header.Py, nullptr}.name();
+}
+
+} // namespace
+
+//static
+int SizeRegistry::main(int argc, char* argv[], std::string_view default_size)
+{
+  std::string_view const size_option = "--size=";
+  std::string_view const tablebase_option = "--tablebase=";
+  std::string size{default_size};
+  std::string origin = "default";
+  std::vector<char*> arguments{argv[0]};
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string_view const arg = argv[i];
+    if (arg.starts_with(size_option))
+    {
+      size = arg.substr(size_option.size());
+      origin = "--size";
+      continue;
+    }
+    if (arg.starts_with(tablebase_option) && origin != "--size")
+    {
+      size = read_tablebase_size(arg.substr(tablebase_option.size()));
+      origin = arg;
+      if (size.empty())
+      {
+        std::cerr << "Could not read the header of " << arg.substr(tablebase_option.size()) << std::endl;
+        return 1;
+      }
+    }
+    arguments.push_back(argv[i]);
+  }
+  arguments.push_back(nullptr);
+
+  Entry const* entry = find(size);
+  if (!entry)
+  {
+    std::cerr << argv[0] << " was not compiled for size " << size << " (" << origin << "); use --size=<BXxBYxPXxPY> with one of:";
+    for (Entry const& e : s_entries())
+      std::cerr << ' ' << e.name();
+    std::cerr << std::endl;
+    return 1;
+  }
+  Dout(dc::notice, "Using size " << size << " (" << origin << ").");
+  return entry->entry_point(arguments.size() - 1, arguments.data());
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The sizes (see Size.h) that a program was compiled for.
+//
+// Everything that depends on Size is compiled once per size, each time in a different inline namespace
+// (SIZE_NAMESPACE), and those copies are linked into the same program. The (per size) main function
+// of the program registers itself with a static Registration object:
+//
+//   inline namespace SIZE_NAMESPACE {
+//   int solve(int argc, char* argv[]) { ... }
+//   SizeRegistry::Registration const registration(Size::Bx, Size::By, Size::Px, Size::Py, &solve);
+//   } // namespace SIZE_NAMESPACE
+//
+// after which the real main function calls SizeRegistry::main to select one of them (see size_main.cxx).
+// Every size keeps its own, fully constexpr, kernels.
+class SizeRegistry
+{
+ public:
+  using entry_point_type = int (*)(int argc, char* argv[]);
+
+  struct Entry
+  {
+    unsigned int Bx, By, Px, Py;
+    entry_point_type entry_point;
+
+    // Returns "BXxBYxPXxPY".
+    std::string name() const;
+  };
+
+  // Register `entry_point` as main function of the program for the size Bx, By, Px, Py.
+  struct Registration
+  {
+    Registration(unsigned int Bx, unsigned int By, unsigned int Px, unsigned int Py, entry_point_type entry_point);
+  };
+
+ private:
+  static std::vector<Entry>& s_entries()
+  {
+    // Constructed on first use, because the Registration objects are constructed during static initialization.
+    static std::vector<Entry> entries;
+    return entries;
+  }
+
+ public:
+  static std::vector<Entry> const& entries() { return s_entries(); }
+
+  // Returns the entry with the name `name` (see Entry::name), or nullptr if this program wasn't compiled for that size.
+  static Entry const* find(std::string_view name);
+
+  // Call the entry point of the selected size with the remaining arguments.
+  //
+  // The size is selected with --size=<BXxBYxPXxPY>, which is removed from the arguments. Otherwise, if there is
+  // an argument --tablebase=<filename> then the size is read from the header of that file (see TablebaseHeader.h).
+  // If neither is given `default_size` is used.
+  static int main(int argc, char* argv[], std::string_view default_size);
+};
@@ -0,0 +1,56 @@
+#include "sys.h"
+#include "SolverCounters.h"
+#include <algorithm>
+#include "debug.h"
+
+//static
+std::mutex SolverCounters::s_mutex;
+//static
+std::vector<SolverCounters*> SolverCounters::s_threads;
+//static
+SolverCounters::values_type SolverCounters::s_exited{};
+
+//static
+char const* SolverCounters::name(counter_type counter)
+{
+  switch (counter)
+  {
+    case parents_generated:
+      return "parents_generated";
+    case parents_accepted:
+      return "parents_accepted";
+    case draw_skips:
+      return "draw_skips";
+    case cas_retries:
+      return "cas_retries";
+    case number_of_counters:
+      break;
+  }
+  ASSERT(false);
+  return "unknown";
+}
+
+SolverCounters::SolverCounters()
+{
+  std::lock_guard<std::mutex> lock(s_mutex);
+  s_threads.push_back(this);
+}
+
+SolverCounters::~SolverCounters()
+{
+  std::lock_guard<std::mutex> lock(s_mutex);
+  for (int counter = 0; counter < number_of_counters; ++counter)
+    s_exited[counter] += counters_[counter].load(std::memory_order_relaxed);
+  s_threads.erase(std::find(s_threads.begin(), s_threads.end(), this));
+}
+
+//static
+SolverCounters::values_type SolverCounters::totals()
+{
+  std::lock_guard<std::mutex> lock(s_mutex);
+  values_type values = s_exited;
+  for (SolverCounters const* thread_counters : s_threads)
+    for (int counter = 0; counter < number_of_counters; ++counter)
+      values[counter] += thread_counters->counters_[counter].load(std::memory_order_relaxed);
+  return values;
+}
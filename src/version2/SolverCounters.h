@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Event counters of the solver (see PlyMetrics.h).
+//
+// Every thread increments its own copy of the counters, so that counting doesn't cause cache line
+// contention between the threads. An increment is not a read-modify-write: only the owning thread
+// writes to its counters, while totals() may read them from any thread.
+class SolverCounters
+{
+ public:
+  enum counter_type
+  {
+    parents_generated,          // The number of (canonical) parents of the processed frontier positions.
+    parents_accepted,           // The number of parents whose ply was determined, and that were added to the next frontier.
+    draw_skips,                 // The number of parents that were skipped because black can force a draw there.
+    cas_retries,                // The number of failed compare-and-swap operations while setting a ply.
+    number_of_counters
+  };
+
+  using values_type = std::array<uint64_t, number_of_counters>;
+
+  static char const* name(counter_type counter);
+
+ private:
+  std::array<std::atomic<uint64_t>, number_of_counters> counters_{};
+
+  static std::mutex s_mutex;
+  static std::vector<SolverCounters*> s_threads;        // The counters of all running threads.
+  static values_type s_exited;                          // The sum of the counters of threads that exited.
+
+  SolverCounters();
+  ~SolverCounters();
+
+  static SolverCounters& this_thread()
+  {
+    static thread_local SolverCounters counters;
+    return counters;
+  }
+
+ public:
+  // Add `n` to `counter` of the current thread.
+  static void add(counter_type counter, uint64_t n = 1)
+  {
+    std::atomic<uint64_t>& value = this_thread().counters_[counter];
+    value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  // Returns the sum of the counters of all threads. Call this while the solver threads are idle to get exact values.
+  static values_type totals();
+};
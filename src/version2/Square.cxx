@@ -2,9 +2,12 @@
 #include "Square.h"
 #include <iostream>
 
+inline namespace SIZE_NAMESPACE {
+
 std::ostream& operator<<(std::ostream& os, Square const& square)
 {
   using namespace coordinates;
   return os << '(' << square[x] << ", " << square[y] << ')';
 }
 
+} // namespace SIZE_NAMESPACE
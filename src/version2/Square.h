@@ -9,6 +9,8 @@
 #include <array>
 #include <cmath>
 
+inline namespace SIZE_NAMESPACE {
+
 // Non-compact coordinates of a board square, suitable for any piece.
 class Square
 {
@@ -48,3 +50,5 @@ class Square
 };
 
 std::ostream& operator<<(std::ostream& os, Square const& square);
+
+} // namespace SIZE_NAMESPACE
@@ -3,6 +3,8 @@
 #include "Size.h"
 #include "debug.h"
 
+inline namespace SIZE_NAMESPACE {
+
 constexpr void constexpr_assert(bool condition, const char* message = "assertion failed") {
     if (!condition) {
         if (std::is_constant_evaluated()) {
@@ -70,3 +72,5 @@ class SquareCompact
   }
 #endif
 };
+
+} // namespace SIZE_NAMESPACE
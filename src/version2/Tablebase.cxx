@@ -0,0 +1,142 @@
+#include "sys.h"
+#include "Tablebase.h"
+#include "Graph.h"
+#include "memory/MemoryMappedPool.h"
+#include "utils/AIAlert.h"
+#include "utils/nearest_multiple_of_power_of_two.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "debug.h"
+
+inline namespace SIZE_NAMESPACE {
+
+namespace {
+
+void pwrite_all(int fd, void const* data, size_t size, off_t offset)
+{
+  char const* ptr = static_cast<char const*>(data);
+  while (size > 0)
+  {
+    ssize_t written = ::pwrite(fd, ptr, size, offset);
+    if (written < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      THROW_ALERTE("pwrite() failed");
+    }
+    ptr += written;
+    size -= written;
+    offset += written;
+  }
+}
+
+} // namespace
+
+//static
+void Tablebase::export_graph(Graph const& graph, std::filesystem::path const& filename)
+{
+  size_t const memory_page_size = memory::MemoryMappedPool::memory_page_size();
+  size_t const table_size = Partition::number_of_partitions * PartitionElement::number_of_elements * sizeof(entry_type);
+
+  Header header{};
+  std::memcpy(header.magic, Header::expected_magic, sizeof(header.magic));
+  header.version = version;
+  header.Bx = Size::Bx;
+  header.By = Size::By;
+  header.Px = Size::Px;
+  header.Py = Size::Py;
+  header.diagonal_symmetry = Size::diagonal_symmetry;
+  header.ply_bits = Classification::ply_bits;
+  header.entry_size = sizeof(entry_type);
+  header.number_of_partitions = Partition::number_of_partitions;
+  header.number_of_elements = PartitionElement::number_of_elements;
+  header.table_offset[black] = utils::nearest_multiple_of_power_of_two(sizeof(Header), memory_page_size);
+  header.table_offset[white] = header.table_offset[black] + utils::nearest_multiple_of_power_of_two(table_size, memory_page_size);
+
+  // Write to a temporary file, so that a table with the final name is always complete.
+  std::filesystem::path tmp_filename = filename;
+  tmp_filename += ".tmp";
+  int fd = ::open(tmp_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1)
+    THROW_ALERTE("Could not open [FILENAME] for writing", AIArgs("[FILENAME]", tmp_filename));
+
+  std::vector<entry_type> buffer(PartitionElement::number_of_elements);
+  int max_ply = 0;
+  for (int color = 0; color < 2; ++color)
+  {
+    Graph::infos_type const& infos = color == black ? graph.black_to_move_infos() : graph.white_to_move_infos();
+    for (Partition partition = infos.ibegin(); partition != infos.iend(); ++partition)
+    {
+      Info::nodes_type const& nodes = infos[partition];
+      for (PartitionElement partition_element = nodes.ibegin(); partition_element != nodes.iend(); ++partition_element)
+      {
+        Classification const& classification = nodes[partition_element].classification();
+        buffer[partition_element.table_index()] = classification.encoded();
+        max_ply = std::max(max_ply, classification.ply());
+      }
+      off_t const offset = header.table_offset[color] +
+        static_cast<PartitionIndex>(partition).get_value() * PartitionElement::number_of_elements * sizeof(entry_type);
+      pwrite_all(fd, buffer.data(), buffer.size() * sizeof(entry_type), offset);
+    }
+  }
+  header.max_ply = max_ply;
+  pwrite_all(fd, &header, sizeof(header), 0);
+
+  // Make the file size a multiple of the page size, so that the whole table can be mapped.
+  if (::ftruncate(fd, header.table_offset[white] + utils::nearest_multiple_of_power_of_two(table_size, memory_page_size)) == -1 ||
+      ::fsync(fd) == -1)
+    THROW_ALERTE("Could not finish writing [FILENAME]", AIArgs("[FILENAME]", tmp_filename));
+  ::close(fd);
+  std::filesystem::rename(tmp_filename, filename);
+}
+
+Tablebase::Tablebase(std::filesystem::path const& filename)
+{
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd == -1)
+    THROW_ALERTE("Could not open [FILENAME]", AIArgs("[FILENAME]", filename));
+  struct stat st;
+  if (::fstat(fd, &st) == -1)
+  {
+    ::close(fd);
+    THROW_ALERTE("fstat() failed");
+  }
+  mapped_size_ = st.st_size;
+  mapped_base_ = mapped_size_ < sizeof(Header) ? MAP_FAILED : ::mmap(nullptr, mapped_size_, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping keeps its own reference to the file.
+  ::close(fd);
+  if (mapped_base_ == MAP_FAILED)
+    THROW_ALERTE("Could not map [FILENAME]", AIArgs("[FILENAME]", filename));
+
+  header_ = static_cast<Header const*>(mapped_base_);
+  size_t const table_size = Partition::number_of_partitions * PartitionElement::number_of_elements * sizeof(entry_type);
+  bool const compatible =
+    std::memcmp(header_->magic, Header::expected_magic, sizeof(Header::expected_magic)) == 0 &&
+    (header_->version == version || (header_->version == 1 && PartitionElement::same_as_bit_packed)) &&
+    header_->Bx == Size::Bx && header_->By == Size::By && header_->Px == Size::Px && header_->Py == Size::Py &&
+    header_->diagonal_symmetry == Size::diagonal_symmetry &&
+    header_->ply_bits == Classification::ply_bits && header_->entry_size == sizeof(entry_type) &&
+    header_->number_of_partitions == Partition::number_of_partitions &&
+    header_->number_of_elements == PartitionElement::number_of_elements &&
+    header_->table_offset[black] + table_size <= mapped_size_ && header_->table_offset[white] + table_size <= mapped_size_;
+  if (!compatible)
+  {
+    ::munmap(mapped_base_, mapped_size_);
+    THROW_ALERT("[FILENAME] is not a version [VERSION] tablebase for this board size",
+        AIArgs("[FILENAME]", filename)("[VERSION]", version));
+  }
+  for (int color = 0; color < 2; ++color)
+    tables_[color] = reinterpret_cast<entry_type const*>(static_cast<char const*>(mapped_base_) + header_->table_offset[color]);
+}
+
+Tablebase::~Tablebase()
+{
+  ::munmap(mapped_base_, mapped_size_);
+}
+
+} // namespace SIZE_NAMESPACE
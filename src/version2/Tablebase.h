@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Board.h"
+#include "Classification.h"
+#include "Partition.h"
+#include "PartitionElement.h"
+#include "TablebaseHeader.h"
+#include "../Color.h"
+#include <cstdint>
+#include <filesystem>
+
+inline namespace SIZE_NAMESPACE {
+
+class Graph;
+
+// A read-only, memory mapped table with the final result of the retrograde analysis.
+//
+// Once all ply are known, the number of children and the AuxiliaryInfo of the solver are no longer needed.
+// The exported table only contains the Classification (the ply plus the classification bits) of every position:
+//
+//   [Header][padding to page boundary][black to move table][padding to page boundary][white to move table]
+//
+// Each table is an array of Classification::encoded_type, with Partition::number_of_partitions times
+// PartitionElement::number_of_elements entries, indexed by `PartitionIndex * number_of_elements + table_index`
+// of the canonical board; i.e. the same layout (including folding) as the Info arrays of the Graph, except that
+// the squares of a block are always numbered row by row (see PartitionElement::table_index).
+// The header (see TablebaseHeader.h) stores Size::Bx/By/Px/Py; opening a table that was written for a different
+// Size fails (use TablebaseView for that).
+class Tablebase
+{
+ public:
+  static constexpr uint32_t version = TablebaseHeader::expected_version;
+  using entry_type = Classification::encoded_type;
+  using Header = TablebaseHeader;
+
+ private:
+  // Returns the index of `board` into the tables.
+  static size_t index(Board board)
+  {
+    // Only canonical boards are stored.
+    board = board.canonical();
+    return static_cast<PartitionIndex>(board.as_partition()).get_value() * PartitionElement::number_of_elements +
+      PartitionElement::table_index(board.black_king().block_square(), board.white_king().block_square(), board.white_rook());
+  }
+
+  void* mapped_base_;
+  size_t mapped_size_;
+  Header const* header_;
+  entry_type const* tables_[2];
+
+ public:
+  // Map an existing table.
+  Tablebase(std::filesystem::path const& filename);
+  ~Tablebase();
+
+  Tablebase(Tablebase const&) = delete;
+  Tablebase& operator=(Tablebase const&) = delete;
+
+  // Write the Classification of every position in `graph` to `filename`.
+  static void export_graph(Graph const& graph, std::filesystem::path const& filename);
+
+  static std::filesystem::path filename(std::filesystem::path const& data_directory)
+  {
+    return Header::filename(data_directory);
+  }
+
+  template<color_type to_move>
+  Classification get_classification(Board board) const
+  {
+    return Classification::from_encoded(tables_[to_move][index(board)]);
+  }
+
+  // Tell the CPU that the entry of `board` will be needed soon.
+  template<color_type to_move>
+  void prefetch(Board board) const
+  {
+    __builtin_prefetch(&tables_[to_move][index(board)]);
+  }
+
+  // Accessor.
+  Header const& header() const { return *header_; }
+};
+
+} // namespace SIZE_NAMESPACE
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+// The header of a tablebase.dtm file (see Tablebase.h).
+//
+// This header doesn't depend on Size, so that programs that read tables of any size (see TablebaseView.h)
+// can use it too.
+struct TablebaseHeader
+{
+  static constexpr char expected_magic[8] = { 'K', 'R', 'v', 'K', 'd', 't', 'm', '\0' };
+  // Version 1 used a bit packed PartitionElement; see PartitionElement::same_as_bit_packed.
+  static constexpr uint32_t expected_version = 2;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t Bx, By, Px, Py;
+  uint32_t diagonal_symmetry;                   // Non-zero if only canonical boards are stored (see Partition.h).
+  uint32_t ply_bits;                            // Classification::ply_bits.
+  uint32_t entry_size;                          // sizeof(Classification::encoded_type).
+  uint32_t max_ply;                             // The largest ply in the table.
+  uint64_t number_of_partitions;
+  uint64_t number_of_elements;                  // Per partition.
+  uint64_t table_offset[2];                     // The file offset of the table, indexed by color_type.
+
+  // The name of the table in `data_directory` (the directory returned by Graph::data_directory).
+  static std::filesystem::path filename(std::filesystem::path const& data_directory)
+  {
+    return data_directory / "tablebase.dtm";
+  }
+};
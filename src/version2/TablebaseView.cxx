@@ -0,0 +1,174 @@
+#include "sys.h"
+#include "TablebaseView.h"
+#include "utils/AIAlert.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "debug.h"
+
+namespace {
+
+// Copy `count` entries of type T, `stride` entries apart, to `out`.
+template<typename T>
+void copy_entries(char const* table, size_t index, size_t stride, int count, uint32_t* out)
+{
+  T const* entries = reinterpret_cast<T const*>(table) + index;
+  if (stride == 1)
+  {
+    for (int i = 0; i < count; ++i)
+      out[i] = entries[i];
+  }
+  else
+  {
+    for (int i = 0; i < count; ++i)
+      out[i] = entries[i * stride];
+  }
+}
+
+} // namespace
+
+TablebaseView::TablebaseView(std::filesystem::path const& filename)
+{
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd == -1)
+    THROW_ALERTE("Could not open [FILENAME]", AIArgs("[FILENAME]", filename));
+  struct stat st;
+  if (::fstat(fd, &st) == -1)
+  {
+    ::close(fd);
+    THROW_ALERTE("fstat() failed");
+  }
+  mapped_size_ = st.st_size;
+  mapped_base_ = mapped_size_ < sizeof(TablebaseHeader) ? MAP_FAILED : ::mmap(nullptr, mapped_size_, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping keeps its own reference to the file.
+  ::close(fd);
+  if (mapped_base_ == MAP_FAILED)
+    THROW_ALERTE("Could not map [FILENAME]", AIArgs("[FILENAME]", filename));
+  header_ = static_cast<TablebaseHeader const*>(mapped_base_);
+
+  // Everything that Size.h, BlockIndex.h and PartitionElement.h calculate at compile time.
+  TablebaseHeader const& header = *header_;
+  // Version 1 is the same as version 2 if all sizes are a power of two (see PartitionElement::same_as_bit_packed);
+  // that is the case if number_of_elements is as expected, which is checked below.
+  bool compatible = std::memcmp(header.magic, TablebaseHeader::expected_magic, sizeof(header.magic)) == 0 &&
+    (header.version == TablebaseHeader::expected_version || header.version == 1) &&
+    header.Bx > 0 && header.By > 0 && header.Px > 0 && header.Py > 0 &&
+    (header.entry_size == 2 || header.entry_size == 4) &&
+    header.diagonal_symmetry == (header.Bx == header.By && header.Px == header.Py);
+  if (compatible)
+  {
+    board_size_x_ = header.Bx * header.Px;
+    board_size_y_ = header.By * header.Py;
+    block_squares_ = static_cast<size_t>(header.Bx) * header.By;
+    board_squares_ = static_cast<size_t>(board_size_x_) * board_size_y_;
+
+    // See partition_folding::make_tables.
+    uint32_t const number_of_blocks = header.Px * header.Py;
+    folded_.resize(number_of_blocks * number_of_blocks);
+    uint32_t partition_index = 0;
+    for (uint32_t unfolded = 0; unfolded < folded_.size(); ++unfolded)
+    {
+      uint32_t const bk = unfolded / number_of_blocks;
+      uint32_t const wk = unfolded % number_of_blocks;
+      int side = static_cast<int>(bk % header.Px) - static_cast<int>(bk / header.Px);
+      if (side == 0)
+        side = static_cast<int>(wk % header.Px) - static_cast<int>(wk / header.Px);
+      folded_[unfolded] = (!header.diagonal_symmetry || side >= 0) ? partition_index++ : static_cast<uint32_t>(-1);
+    }
+
+    // Every combination of the black king, white king and white rook square has an InfoIndex.
+    size_t const number_of_elements = block_squares_ * block_squares_ * board_squares_;
+    size_t const table_size = header.number_of_partitions * header.number_of_elements * header.entry_size;
+    compatible = header.number_of_partitions == partition_index && header.number_of_elements == number_of_elements &&
+      header.table_offset[black] + table_size <= mapped_size_ && header.table_offset[white] + table_size <= mapped_size_;
+  }
+  if (!compatible)
+  {
+    ::munmap(mapped_base_, mapped_size_);
+    THROW_ALERT("[FILENAME] is not a version [VERSION] tablebase",
+        AIArgs("[FILENAME]", filename)("[VERSION]", TablebaseHeader::expected_version));
+  }
+  for (int color = 0; color < 2; ++color)
+    tables_[color] = static_cast<char const*>(mapped_base_) + header.table_offset[color];
+}
+
+TablebaseView::~TablebaseView()
+{
+  ::munmap(mapped_base_, mapped_size_);
+}
+
+size_t TablebaseView::index(int bkx, int bky, int wkx, int wky, int wrx, int wry) const
+{
+  uint32_t const Bx = header_->Bx;
+  uint32_t const By = header_->By;
+  uint32_t const Px = header_->Px;
+  uint32_t const number_of_blocks = Px * header_->Py;
+  // See BlockIndex::xy_to_index and Partition::Partition.
+  size_t const bk_block = (bky / By) * Px + bkx / Bx;
+  size_t const wk_block = (wky / By) * Px + wkx / Bx;
+  size_t const partition_index = folded_[wk_block + number_of_blocks * bk_block];
+  ASSERT(partition_index != static_cast<uint32_t>(-1));
+  // See PartitionElementBase::info_index.
+  size_t info_index = (bky % By) * Bx + bkx % Bx;
+  info_index *= block_squares_;
+  info_index += (wky % By) * Bx + wkx % Bx;
+  info_index *= board_squares_;
+  info_index += static_cast<size_t>(wry) * board_size_x_ + wrx;
+  return partition_index * header_->number_of_elements + info_index;
+}
+
+int TablebaseView::kings_side(int bkx, int bky, int wkx, int wky) const
+{
+  if (!header_->diagonal_symmetry)
+    return 1;
+  // See Board::is_canonical.
+  uint32_t const Bx = header_->Bx;
+  int side = static_cast<int>(bkx / Bx) - static_cast<int>(bky / Bx);
+  if (side == 0)
+    side = static_cast<int>(wkx / Bx) - static_cast<int>(wky / Bx);
+  if (side != 0)
+    return side;
+  side = bkx - bky;
+  if (side == 0)
+    side = wkx - wky;
+  return side;
+}
+
+uint32_t TablebaseView::load(color_type to_move, size_t index) const
+{
+  if (header_->entry_size == 2)
+    return reinterpret_cast<uint16_t const*>(tables_[to_move])[index];
+  return reinterpret_cast<uint32_t const*>(tables_[to_move])[index];
+}
+
+uint32_t TablebaseView::entry(color_type to_move, int bkx, int bky, int wkx, int wky, int wrx, int wry) const
+{
+  int side = kings_side(bkx, bky, wkx, wky);
+  if (side == 0)
+    side = wrx - wry;
+  return side >= 0 ? load(to_move, index(bkx, bky, wkx, wky, wrx, wry)) : load(to_move, index(bky, bkx, wky, wkx, wry, wrx));
+}
+
+void TablebaseView::get_row(color_type to_move, int bkx, int bky, int wkx, int wky, int wry, int width, uint32_t* row) const
+{
+  ASSERT(0 <= wry && wry < board_size_y_ && width <= board_size_x_);
+  auto copy = header_->entry_size == 2 ? &copy_entries<uint16_t> : &copy_entries<uint32_t>;
+  // The stride between the rook on (wry, wrx) and (wry, wrx + 1) in a mirrored position.
+  size_t const column_stride = board_size_x_;
+  int const side = kings_side(bkx, bky, wkx, wky);
+  if (side > 0)
+    copy(tables_[to_move], index(bkx, bky, wkx, wky, 0, wry), 1, width, row);
+  else if (side < 0)
+    copy(tables_[to_move], index(bky, bkx, wky, wkx, wry, 0), column_stride, width, row);
+  else
+  {
+    // Both kings are on the diagonal (so they are their own mirror image); the positions with the rook
+    // below the diagonal (wrx >= wry) are stored as they are, the others mirrored.
+    int const mirrored = std::min(wry, width);
+    copy(tables_[to_move], index(bkx, bky, wkx, wky, wry, 0), column_stride, mirrored, row);
+    copy(tables_[to_move], index(bkx, bky, wkx, wky, mirrored, wry), 1, width - mirrored, row + mirrored);
+  }
+}
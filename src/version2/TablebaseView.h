@@ -0,0 +1,75 @@
+#pragma once
+
+#include "TablebaseHeader.h"
+#include "../Color.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// A read-only, memory mapped tablebase.dtm of any size.
+//
+// Tablebase can only open a table that was written for the Size that the program was compiled for, because
+// it uses Board, Partition and PartitionElement to calculate the index of a position. This class reads the
+// sizes from the header instead and does the same index calculation (including the diagonal symmetry and
+// the folding of Partition.h) at run time, so that one program can read tables of different sizes.
+//
+// Entries are returned as they are stored: the encoded Classification, widened to 32 bits.
+class TablebaseView
+{
+ public:
+  // See Classification.h.
+  static constexpr int number_of_bits = 5;
+  static constexpr uint32_t legal = 16;
+  static constexpr uint32_t bits_mask = (uint32_t{1} << number_of_bits) - 1;
+  static constexpr int mate_in_ply_shift = number_of_bits;
+
+  // Returns true if the position of `entry` is legal.
+  static bool is_legal(uint32_t entry) { return entry & legal; }
+  // Returns the number of ply till mate of `entry`, or -1 if that is unknown (a draw).
+  static int ply(uint32_t entry) { return static_cast<int>(entry >> mate_in_ply_shift) - 1; }
+
+ private:
+  void* mapped_base_;
+  size_t mapped_size_;
+  TablebaseHeader const* header_;
+  char const* tables_[2];
+
+  // Derived from the header.
+  int board_size_x_;
+  int board_size_y_;
+  size_t block_squares_;                        // Bx * By.
+  size_t board_squares_;                        // board_size_x_ * board_size_y_.
+  std::vector<uint32_t> folded_;                // Unfolded partition index (wk + number_of_blocks * bk) --> PartitionIndex.
+
+ public:
+  // Map an existing table.
+  TablebaseView(std::filesystem::path const& filename);
+  ~TablebaseView();
+
+  TablebaseView(TablebaseView const&) = delete;
+  TablebaseView& operator=(TablebaseView const&) = delete;
+
+  // Accessors.
+  TablebaseHeader const& header() const { return *header_; }
+  int board_size_x() const { return board_size_x_; }
+  int board_size_y() const { return board_size_y_; }
+
+  // Returns the entry of the position with the black king on (bkx, bky), the white king on (wkx, wky)
+  // and the white rook on (wrx, wry).
+  uint32_t entry(color_type to_move, int bkx, int bky, int wkx, int wky, int wrx, int wry) const;
+
+  // Write the entries of the positions with the rook on (0, wry) .. (width - 1, wry) to row[0] .. row[width - 1].
+  // This is much faster than calling entry() for each of them, because most rows are stored contiguously.
+  void get_row(color_type to_move, int bkx, int bky, int wkx, int wky, int wry, int width, uint32_t* row) const;
+
+ private:
+  // Returns the index of a canonical position.
+  size_t index(int bkx, int bky, int wkx, int wky, int wrx, int wry) const;
+
+  // Returns a positive value if the position is canonical (see Board::is_canonical), a negative value
+  // if its mirror image is stored and zero if that depends on the rook (both kings are on the diagonal).
+  int kings_side(int bkx, int bky, int wkx, int wky) const;
+
+  uint32_t load(color_type to_move, size_t index) const;
+};
@@ -0,0 +1,127 @@
+#include "sys.h"
+#include "Trace.h"
+#include "utils/AIAlert.h"
+#include <fstream>
+#include "debug.h"
+
+//static
+std::atomic<bool> Trace::s_enabled;
+//static
+std::mutex Trace::s_mutex;
+//static
+std::filesystem::path Trace::s_filename;
+//static
+Trace::clock_type::time_point Trace::s_start;
+//static
+std::vector<Trace::Event> Trace::s_events;
+//static
+std::atomic<int> Trace::s_next_thread_id;
+//static
+int Trace::s_main_thread_id;
+//static
+thread_local TraceScope* TraceScope::s_innermost;
+
+namespace {
+
+// Write `str` as a JSON string.
+void write_string(std::ostream& os, std::string const& str)
+{
+  os << '"';
+  for (char c : str)
+  {
+    if (c == '"' || c == '\\')
+      os << '\\' << c;
+    else if (static_cast<unsigned char>(c) < 0x20)
+      os << ' ';
+    else
+      os << c;
+  }
+  os << '"';
+}
+
+} // namespace
+
+//static
+void Trace::start(std::filesystem::path const& filename)
+{
+  // The thread that starts the trace is called "main" (it has id 0, unless it isn't the first thread).
+  s_main_thread_id = thread_id();
+  std::lock_guard<std::mutex> lock(s_mutex);
+  s_filename = filename;
+  s_start = clock_type::now();
+  s_events.clear();
+  s_enabled = true;
+}
+
+//static
+int Trace::thread_id()
+{
+  static thread_local int id = s_next_thread_id++;
+  return id;
+}
+
+//static
+void Trace::complete(std::string name, char const* category, clock_type::time_point begin, clock_type::time_point end, std::string args)
+{
+  int const id = thread_id();
+  std::lock_guard<std::mutex> lock(s_mutex);
+  if (!s_enabled)
+    return;
+  s_events.emplace_back(std::move(name), category, begin, end, id, std::move(args));
+}
+
+//static
+std::string Trace::current_phase()
+{
+  TraceScope const* innermost = TraceScope::s_innermost;
+  return innermost ? innermost->name_ : std::string{};
+}
+
+//static
+void Trace::stop()
+{
+  std::lock_guard<std::mutex> lock(s_mutex);
+  if (!s_enabled)
+    return;
+  s_enabled = false;
+
+  std::ofstream os(s_filename, std::ios::trunc);
+  if (!os)
+    THROW_ALERTE("Could not open [FILENAME] for writing", AIArgs("[FILENAME]", s_filename));
+  auto microseconds = [](clock_type::duration duration){ return std::chrono::duration<double, std::micro>(duration).count(); };
+  os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  // Name the threads.
+  int const number_of_threads = s_next_thread_id;
+  for (int id = 0; id < number_of_threads; ++id)
+    os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << id << ",\"args\":{\"name\":\"" <<
+      (id == s_main_thread_id ? "main" : "thread " + std::to_string(id)) << "\"}},\n";
+  char const* separator = "";
+  for (Event const& event : s_events)
+  {
+    os << separator << "{\"name\":";
+    write_string(os, event.name);
+    os << ",\"cat\":\"" << event.category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread_id <<
+      ",\"ts\":" << microseconds(event.begin - s_start) << ",\"dur\":" << microseconds(event.end - event.begin);
+    if (!event.args.empty())
+      os << ",\"args\":" << event.args;
+    os << '}';
+    separator = ",\n";
+  }
+  os << "\n]}" << std::endl;
+  s_events.clear();
+}
+
+TraceScope::TraceScope(char const* category, std::string name) :
+  name_(std::move(name)), category_(category), parent_(s_innermost), enabled_(Trace::enabled())
+{
+  s_innermost = this;
+  if (enabled_)
+    begin_ = Trace::clock_type::now();
+}
+
+TraceScope::~TraceScope()
+{
+  s_innermost = parent_;
+  if (enabled_)
+    Trace::complete(std::move(name_), category_, begin_, Trace::clock_type::now());
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// A timeline of the solver in the Chrome trace event format.
+//
+// When enabled (infchess2 --trace=<filename>) every task that is run with run_tasks, and every phase of the
+// solver that is marked with a TraceScope, is recorded as a "complete" event on the timeline of the thread
+// that executed it. The resulting file can be loaded in chrome://tracing or https://ui.perfetto.dev.
+//
+// Tasks are named after the innermost TraceScope of the thread that queued them (for example "ply 7 (white)"),
+// and have the time that they spent in the queue of the thread pool as argument (queue_delay_us).
+//
+// Recording only takes a mutex per event; there are a few events per task, not per position.
+class Trace
+{
+ public:
+  using clock_type = std::chrono::steady_clock;
+
+ private:
+  struct Event
+  {
+    std::string name;
+    char const* category;
+    clock_type::time_point begin;
+    clock_type::time_point end;
+    int thread_id;
+    std::string args;                           // A JSON object, or empty.
+  };
+
+  static std::atomic<bool> s_enabled;
+  static std::mutex s_mutex;
+  static std::filesystem::path s_filename;
+  static clock_type::time_point s_start;
+  static std::vector<Event> s_events;
+  static std::atomic<int> s_next_thread_id;
+  static int s_main_thread_id;
+
+ public:
+  // Start recording events; they are written to `filename` by stop().
+  static void start(std::filesystem::path const& filename);
+  // Stop recording and write the events that were recorded so far.
+  static void stop();
+
+  static bool enabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+  // Record that the current thread spent [begin, end> on `name`. `args` must be a JSON object or empty.
+  static void complete(std::string name, char const* category, clock_type::time_point begin, clock_type::time_point end,
+      std::string args = {});
+
+  // Returns the name of the innermost TraceScope of the current thread (or an empty string).
+  static std::string current_phase();
+
+ private:
+  friend class TraceScope;
+  static int thread_id();
+};
+
+// Records the lifetime of this object as a phase of the current thread (if tracing is enabled).
+class TraceScope
+{
+ private:
+  std::string name_;
+  char const* category_;
+  Trace::clock_type::time_point begin_;
+  TraceScope* parent_;
+  bool enabled_;
+
+  static thread_local TraceScope* s_innermost;
+
+  friend class Trace;
+
+ public:
+  TraceScope(char const* category, std::string name);
+  ~TraceScope();
+
+  TraceScope(TraceScope const&) = delete;
+  TraceScope& operator=(TraceScope const&) = delete;
+};
@@ -19,3 +19,30 @@ struct UncompressedInfo
   uint16_t number_of_children;
 };
 
+// The framed query protocol of mmap_server (all fields in host order).
+//
+// A request is a QueryHeader followed by `number_of_boards` UncompressedBoard records. The reply is a ReplyHeader
+// with the same request_id and number_of_boards, followed by two UncompressedInfo records per board (black to move
+// and white to move). A client may send any number of requests without waiting for the replies; the replies are
+// sent in the same order.
+//
+// The first byte of query_magic is 0xff, which can't be the first byte of an UncompressedBoard; a connection whose
+// first bytes are not query_magic uses the old protocol: a stream of UncompressedBoard records without header,
+// where every recv() that completes at least one record is answered separately.
+struct QueryHeader
+{
+  static constexpr uint32_t query_magic = 0x51524bff;   // "\xffKRQ" on a little endian machine.
+
+  uint32_t magic;
+  uint32_t request_id;
+  uint32_t number_of_boards;
+};
+
+struct ReplyHeader
+{
+  static constexpr uint32_t reply_magic = 0x52524bff;   // "\xffKRR" on a little endian machine.
+
+  uint32_t magic;
+  uint32_t request_id;
+  uint32_t number_of_boards;
+};
@@ -0,0 +1,76 @@
+#include "sys.h"
+#include "UpdateBuckets.h"
+#include "SolverCounters.h"
+#include "debug.h"
+
+inline namespace SIZE_NAMESPACE {
+
+template<color_type child_to_move>
+ChunkedRunTimes UpdateBuckets::collect(AIThreadPool& thread_pool, AIQueueHandle queue_handle, Graph const& graph, int ply, Frontier const& children)
+{
+  // This number of ply plus one must fit in a ply_type.
+  ASSERT(ply + 1 < Classification::max_encoded_ply);
+  int const number_of_tasks = task_buckets_.size();
+  return children.for_each(thread_pool, queue_handle, number_of_tasks, [this, &graph, ply](int task_n, Board child){
+    // All positions in the frontier have their ply just determined.
+    ASSERT(graph.get_info<child_to_move>(child).classification().ply() == ply);
+    // Generate all parent positions.
+    Board::neighbors_type parents;
+    int number_of_parents = (child_to_move == black) ?
+      child.generate_neighbors<Board::parents, white>(parents) :
+      child.generate_neighbors<Board::parents, black>(parents);
+    // Parents that are each other's mirror image are the same node; each must be counted only once.
+    number_of_parents = Board::canonicalize_neighbors(parents, number_of_parents);
+    SolverCounters::add(SolverCounters::parents_generated, number_of_parents);
+    buckets_type& buckets = task_buckets_[task_n];
+    for (int i = 0; i < number_of_parents; ++i)
+      buckets[parents[i].as_partition()].push_back(parents[i].as_partition_element());
+  });
+}
+
+template<color_type child_to_move>
+ChunkedRunTimes UpdateBuckets::apply(AIThreadPool& thread_pool, AIQueueHandle queue_handle, Graph& graph, int ply, Frontier& parents_out)
+{
+  constexpr color_type parent_to_move = (child_to_move == black) ? white : black;
+  Classification::ply_type const parent_ply = ply + 1;
+  int const number_of_tasks = task_buckets_.size();
+  // Each partition is one item: the task that takes it is the only one that accesses the Info of that partition.
+  return run_chunked(thread_pool, queue_handle, number_of_tasks, Partition::number_of_partitions, 1,
+      [this, &graph, parent_ply, &parents_out](int /*task_n*/, size_t begin, size_t end){
+        for (Partition partition = PartitionIndex{begin}; partition != PartitionIndex{end}; ++partition)
+        {
+          for (buckets_type& buckets : task_buckets_)
+          {
+            bucket_type& bucket = buckets[partition];
+            for (size_t i = 0; i < bucket.size(); ++i)
+            {
+              // Prefetch the parents of a few updates ahead, so that their cache misses overlap with the current update.
+              if (i + prefetch_distance < bucket.size())
+              {
+                auto [next_info, next_auxiliary_info] =
+                  graph.get_info_tuple<parent_to_move>(partition, PartitionElement{bucket[i + prefetch_distance]});
+                __builtin_prefetch(&next_info, 1);
+                if constexpr (parent_to_move == black)
+                  __builtin_prefetch(&next_auxiliary_info, 1);
+              }
+              PartitionElement const partition_element{bucket[i]};
+              auto [parent_info, parent_auxiliary_info] = graph.get_info_tuple<parent_to_move>(partition, partition_element);
+              bool const parent_ply_set = (parent_to_move == white) ?
+                parent_info.white_to_move_parent_reached(parent_ply) :
+                parent_info.black_to_move_parent_reached(parent_auxiliary_info, parent_ply);
+              if (parent_ply_set)
+                parents_out.insert(Board{partition, partition_element});
+            }
+            bucket.clear();
+          }
+        }
+      });
+}
+
+// Explicit instantiations.
+template ChunkedRunTimes UpdateBuckets::collect<black>(AIThreadPool&, AIQueueHandle, Graph const&, int, Frontier const&);
+template ChunkedRunTimes UpdateBuckets::collect<white>(AIThreadPool&, AIQueueHandle, Graph const&, int, Frontier const&);
+template ChunkedRunTimes UpdateBuckets::apply<black>(AIThreadPool&, AIQueueHandle, Graph&, int, Frontier&);
+template ChunkedRunTimes UpdateBuckets::apply<white>(AIThreadPool&, AIQueueHandle, Graph&, int, Frontier&);
+
+} // namespace SIZE_NAMESPACE
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Frontier.h"
+#include "Graph.h"
+#include "run_chunked.h"
+#include "utils/Array.h"
+#include <vector>
+
+inline namespace SIZE_NAMESPACE {
+
+// The parents found while processing one ply, bucketed by the partition that they belong to.
+//
+// This implements an "owner computes" mode for the retrograde analysis, where each ply is processed in two steps:
+//   1) collect: the tasks run over the frontier and generate the parents of each position, but instead of
+//      updating the Info of those parents they only append the PartitionElement of each parent to the bucket
+//      of the partition of that parent. Each task has its own buckets, so this doesn't need any synchronization.
+//   2) apply: the partitions are distributed over the tasks. The task that owns a partition applies all updates
+//      to it, so that every task works on the Info of a single partition at a time (instead of jumping through
+//      the whole memory mapped file).
+class UpdateBuckets
+{
+ public:
+  using bucket_type = std::vector<InfoIndex>;
+  using buckets_type = utils::Array<bucket_type, Partition::number_of_partitions, PartitionIndex>;
+
+ private:
+  std::vector<buckets_type> task_buckets_;      // The buckets of each task, used during the collect step.
+
+  // The number of updates that the apply step looks ahead to prefetch the Info of the parent.
+  static constexpr size_t prefetch_distance = 8;
+
+ public:
+  // Use `number_of_tasks` tasks for the collect step.
+  UpdateBuckets(int number_of_tasks) : task_buckets_(number_of_tasks) { }
+
+  // Generate the parents of all positions in `children`, which must be mate in `ply` ply with `child_to_move` to move.
+  template<color_type child_to_move>
+  ChunkedRunTimes collect(AIThreadPool& thread_pool, AIQueueHandle queue_handle, Graph const& graph, int ply, Frontier const& children);
+
+  // Update the Info of all collected parents, and add those that are now known to be mate in `ply + 1` ply to parents_out.
+  template<color_type child_to_move>
+  ChunkedRunTimes apply(AIThreadPool& thread_pool, AIQueueHandle queue_handle, Graph& graph, int ply, Frontier& parents_out);
+};
+
+} // namespace SIZE_NAMESPACE
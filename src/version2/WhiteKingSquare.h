@@ -2,6 +2,8 @@
 
 #include "KingSquare.h"
 
+inline namespace SIZE_NAMESPACE {
+
 class WhiteKingSquare : public KingSquare
 {
  public:
@@ -9,3 +11,4 @@ class WhiteKingSquare : public KingSquare
   WhiteKingSquare(int x, int y) : KingSquare(x, y) { }
 };
 
+} // namespace SIZE_NAMESPACE
@@ -2,6 +2,8 @@
 
 #include "SquareCompact.h"
 
+inline namespace SIZE_NAMESPACE {
+
 // This class exist of an unsigned integer that uses the Size::board::square_bits least significant bits.
 // The other bits are guaranteed to be zero.
 class WhiteRookSquare : public SquareCompact<Size::board>
@@ -13,3 +15,5 @@ class WhiteRookSquare : public SquareCompact<Size::board>
   WhiteRookSquare(coordinates_type square) : SquareCompact<Size::board>(square) { }
   WhiteRookSquare(int x, int y) : SquareCompact<Size::board>(x, y) { }
 };
+
+} // namespace SIZE_NAMESPACE
@@ -0,0 +1,48 @@
+#include "sys.h"
+#include "answer_query.h"
+#include "Tablebase.h"
+#include "debug.h"
+
+inline namespace SIZE_NAMESPACE {
+
+namespace {
+
+template<color_type to_move>
+int number_of_children(Board const& board, Classification const& classification)
+{
+  if (!classification.is_legal() || classification.is_draw())
+    return 0;
+  Board::neighbors_type children;
+  int const number_of_children = board.generate_neighbors<Board::children, to_move>(children);
+  // Children that are each other's mirror image are the same node.
+  return Board::canonicalize_neighbors(children, number_of_children);
+}
+
+template<color_type to_move>
+UncompressedInfo uncompressed_info(Tablebase const& tablebase, Board const& board)
+{
+  Classification const classification = tablebase.get_classification<to_move>(board);
+  UncompressedInfo uncompressed_info{classification.ply_encoded(), classification.bits(),
+    static_cast<uint16_t>(number_of_children<to_move>(board, classification))};
+  return uncompressed_info;
+}
+
+} // namespace
+
+bool is_on_board(UncompressedBoard const& board)
+{
+  return board.bkx < Size::board::x && board.bky < Size::board::y &&
+         board.wkx < Size::board::x && board.wky < Size::board::y &&
+         board.wrx < Size::board::x && board.wry < Size::board::y;
+}
+
+void answer_query(Tablebase const& tablebase, UncompressedBoard const& uncompressed_board, UncompressedInfo* infos)
+{
+  ASSERT(is_on_board(uncompressed_board));
+  Board board({uncompressed_board.bkx, uncompressed_board.bky},
+      {uncompressed_board.wkx, uncompressed_board.wky}, {uncompressed_board.wrx, uncompressed_board.wry});
+  infos[0] = uncompressed_info<black>(tablebase, board);
+  infos[1] = uncompressed_info<white>(tablebase, board);
+}
+
+} // namespace SIZE_NAMESPACE
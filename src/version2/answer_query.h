@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Size.h"
+#include "Uncompressed.h"
+
+inline namespace SIZE_NAMESPACE {
+
+class Tablebase;
+
+// Returns true if all coordinates of `board` are on the board.
+bool is_on_board(UncompressedBoard const& board);
+
+// Look up `board` (which must be on the board) in `tablebase` and write the result with black to move
+// to infos[0] and with white to move to infos[1].
+//
+// The tablebase doesn't store the number of children; it is calculated the same way as Graph::classify does.
+void answer_query(Tablebase const& tablebase, UncompressedBoard const& board, UncompressedInfo* infos);
+
+} // namespace SIZE_NAMESPACE
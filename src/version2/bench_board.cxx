@@ -0,0 +1,188 @@
+#include "sys.h"
+#include "Board.h"
+#include "../Color.h"
+#include <charconv>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string_view>
+#include <vector>
+#include "debug.h"
+
+// Microbenchmarks of the Board kernels that are used by every phase of the solver.
+//
+// Every kernel is run over a set of random positions (the same set for every run with the same seed),
+// repeatedly until at least --min-time milliseconds passed. The result of each kernel is written to stdout
+// as one JSON line:
+//
+//   {"board_x":32,"board_y":32,"Bx":8,"By":8,"Px":4,"Py":4,"kernel":"generate_neighbors<children, white>",
+//    "positions":65536,"calls":12345678,"ns_per_call":12.3,"boards_per_second":1.2e9,"checksum":1234}
+//
+// where boards_per_second is the number of boards that were generated per second for the kernels that
+// generate boards (generate_neighbors, generate_king_moves and generate_rook_moves), and the number of
+// input boards per second for the others. The checksum only exists to keep the results of the kernels alive.
+
+inline namespace SIZE_NAMESPACE {
+
+// See Board.h.
+struct BoardBenchmark
+{
+  template<int xy, Board::FieldType ft>
+  static bool inc_field(Board& board) { return board.inc_field<xy, ft>(); }
+
+  template<int xy, Board::FieldType ft>
+  static bool dec_field(Board& board) { return board.dec_field<xy, ft>(); }
+
+  template<int xy, color_type color>
+  static bool inc_king(Board& board) { return board.inc_king<xy, color>(); }
+
+  template<int xy, color_type color>
+  static bool dec_king(Board& board) { return board.dec_king<xy, color>(); }
+};
+
+} // namespace SIZE_NAMESPACE
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+// The positions that the kernels are run on.
+struct Positions
+{
+  std::vector<Board> any;                       // Random boards, including illegal ones.
+  std::vector<Board> legal[2];                  // Legal positions, indexed by the color to move.
+  std::vector<Board> not_draw[2];               // Legal positions that are not a draw (the only ones whose neighbors are generated).
+};
+
+Positions make_positions(size_t number_of_positions, uint64_t seed)
+{
+  std::mt19937_64 generator(seed);
+  std::uniform_int_distribution<int> random_x(0, Size::board::x - 1);
+  std::uniform_int_distribution<int> random_y(0, Size::board::y - 1);
+  Positions positions;
+  while (positions.any.size() < number_of_positions || positions.not_draw[black].size() < number_of_positions ||
+      positions.not_draw[white].size() < number_of_positions)
+  {
+    int const bkx = random_x(generator), bky = random_y(generator);
+    int const wkx = random_x(generator), wky = random_y(generator);
+    int const wrx = random_x(generator), wry = random_y(generator);
+    Board const board{BlackKingSquare{bkx, bky}, WhiteKingSquare{wkx, wky}, WhiteRookSquare{wrx, wry}};
+    if (positions.any.size() < number_of_positions)
+      positions.any.push_back(board);
+    for (int color = 0; color < 2; ++color)
+    {
+      Color const to_move(static_cast<color_type>(color));
+      if (positions.not_draw[color].size() >= number_of_positions || !board.determine_legal(to_move))
+        continue;
+      if (positions.legal[color].size() < number_of_positions)
+        positions.legal[color].push_back(board);
+      if (!board.determine_draw(to_move))
+        positions.not_draw[color].push_back(board);
+    }
+  }
+  return positions;
+}
+
+// Run `kernel` on all `boards` until at least `min_time` passed, and write the result.
+//
+// The value returned by the kernel is used, so that the compiler can't optimize the call away.
+// If `generator` is true then the kernel returns the number of boards that it generated.
+template<typename KERNEL>
+void benchmark(std::string_view name, bool generator, std::vector<Board> const& boards, clock_type::duration min_time, KERNEL kernel)
+{
+  size_t calls = 0;
+  size_t generated = 0;
+  size_t sink = 0;
+  auto const start = clock_type::now();
+  clock_type::duration elapsed;
+  do
+  {
+    for (Board board : boards)
+    {
+      size_t const result = kernel(board);
+      if (generator)
+        generated += result;
+      sink += result;
+    }
+    calls += boards.size();
+    if (!generator)
+      generated = calls;
+    elapsed = clock_type::now() - start;
+  }
+  while (elapsed < min_time);
+
+  double const seconds = std::chrono::duration<double>(elapsed).count();
+  std::cout << "{\"board_x\":" << Size::board::x << ",\"board_y\":" << Size::board::y <<
+    ",\"Bx\":" << Size::Bx << ",\"By\":" << Size::By << ",\"Px\":" << Size::Px << ",\"Py\":" << Size::Py <<
+    ",\"kernel\":\"" << name << "\",\"positions\":" << boards.size() << ",\"calls\":" << calls <<
+    ",\"ns_per_call\":" << (1e9 * seconds / calls) << ",\"boards_per_second\":" << (generated / seconds) <<
+    ",\"checksum\":" << (sink & 0xffff) << "}" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  // Command line options.
+  size_t number_of_positions = 1 << 16;         // The number of positions per set.
+  int min_time_ms = 200;                        // The minimum time that each kernel runs.
+  uint64_t seed = 1;                            // The seed of the random positions.
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string_view const arg = argv[i];
+    auto parse = [arg]<typename T>(std::string_view option, T& value){
+      return arg.starts_with(option) &&
+        std::from_chars(arg.data() + option.size(), arg.data() + arg.size(), value).ec == std::errc{} && value > 0;
+    };
+    if (parse("--positions=", number_of_positions) || parse("--min-time=", min_time_ms) || parse("--seed=", seed))
+      continue;
+    std::cerr << "Usage: " << argv[0] << " [--positions=<number>] [--min-time=<milliseconds>] [--seed=<number>]" << std::endl;
+    return 1;
+  }
+
+  Positions const positions = make_positions(number_of_positions, seed);
+  clock_type::duration const min_time = std::chrono::milliseconds(min_time_ms);
+  using namespace coordinates;
+  Board::neighbors_type neighbors;
+
+  // The board generators. Parents are generated of positions with the other color to move.
+  benchmark("generate_neighbors<children, black>", true, positions.not_draw[black], min_time,
+      [&](Board board){ return board.generate_neighbors<Board::children, black>(neighbors); });
+  benchmark("generate_neighbors<children, white>", true, positions.not_draw[white], min_time,
+      [&](Board board){ return board.generate_neighbors<Board::children, white>(neighbors); });
+  benchmark("generate_neighbors<parents, black>", true, positions.not_draw[white], min_time,
+      [&](Board board){ return board.generate_neighbors<Board::parents, black>(neighbors); });
+  benchmark("generate_neighbors<parents, white>", true, positions.not_draw[black], min_time,
+      [&](Board board){ return board.generate_neighbors<Board::parents, white>(neighbors); });
+  benchmark("generate_king_moves<children, black>", true, positions.not_draw[black], min_time,
+      [&](Board board){ int n = 0; board.generate_king_moves<Board::children, black>(neighbors, n); return n; });
+  benchmark("generate_king_moves<children, white>", true, positions.not_draw[white], min_time,
+      [&](Board board){ int n = 0; board.generate_king_moves<Board::children, white>(neighbors, n); return n; });
+  benchmark("generate_king_moves<parents, black>", true, positions.not_draw[white], min_time,
+      [&](Board board){ int n = 0; board.generate_king_moves<Board::parents, black>(neighbors, n); return n; });
+  benchmark("generate_king_moves<parents, white>", true, positions.not_draw[black], min_time,
+      [&](Board board){ int n = 0; board.generate_king_moves<Board::parents, white>(neighbors, n); return n; });
+  benchmark("generate_rook_moves<children>", true, positions.not_draw[white], min_time,
+      [&](Board board){ int n = 0; board.generate_rook_moves<Board::children>(neighbors, n); return n; });
+  benchmark("generate_rook_moves<parents>", true, positions.not_draw[black], min_time,
+      [&](Board board){ int n = 0; board.generate_rook_moves<Board::parents>(neighbors, n); return n; });
+
+  // The field operations that the generators are made of.
+  benchmark("inc_field<x, wr>", false, positions.any, min_time, [](Board board){ return BoardBenchmark::inc_field<x, Board::wr>(board) + board.get_encoded(); });
+  benchmark("inc_field<y, wr>", false, positions.any, min_time, [](Board board){ return BoardBenchmark::inc_field<y, Board::wr>(board) + board.get_encoded(); });
+  benchmark("dec_field<x, wr>", false, positions.any, min_time, [](Board board){ return BoardBenchmark::dec_field<x, Board::wr>(board) + board.get_encoded(); });
+  benchmark("dec_field<y, wr>", false, positions.any, min_time, [](Board board){ return BoardBenchmark::dec_field<y, Board::wr>(board) + board.get_encoded(); });
+  benchmark("inc_king<x, black>", false, positions.any, min_time, [](Board board){ return BoardBenchmark::inc_king<x, black>(board) + board.get_encoded(); });
+  benchmark("inc_king<y, black>", false, positions.any, min_time, [](Board board){ return BoardBenchmark::inc_king<y, black>(board) + board.get_encoded(); });
+  benchmark("dec_king<x, white>", false, positions.any, min_time, [](Board board){ return BoardBenchmark::dec_king<x, white>(board) + board.get_encoded(); });
+  benchmark("dec_king<y, white>", false, positions.any, min_time, [](Board board){ return BoardBenchmark::dec_king<y, white>(board) + board.get_encoded(); });
+
+  // The classification.
+  benchmark("determine_legal(black)", false, positions.any, min_time, [](Board board){ return board.determine_legal(black); });
+  benchmark("determine_legal(white)", false, positions.any, min_time, [](Board board){ return board.determine_legal(white); });
+  benchmark("determine_draw(black)", false, positions.legal[black], min_time, [](Board board){ return board.determine_draw(black); });
+  benchmark("determine_draw(white)", false, positions.legal[white], min_time, [](Board board){ return board.determine_draw(white); });
+}
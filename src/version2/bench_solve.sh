@@ -0,0 +1,125 @@
+#! /bin/bash
+
+# Solve KRvK for a number of board and block sizes and print one table with the results.
+#
+# Usage: bench_solve.sh [-B <build directory>] [-D <VAR=VALUE>]... [-d <scratch directory>] [-o <filename>] <size>... [-- <infchess2 options>]
+#
+# Every <size> is BXxBYxPXxPY (see Size.h): the size of a block and the number of blocks, for example
+#
+#   src/version2/bench_solve.sh 4x4x2x2 2x2x4x4 8x8x1x1 3x3x3x3 4x4x3x3 -- --owner-computes
+#
+# compares three partitionings of the 8x8 board and adds a 9x9 and a 12x12 board.
+# This builds infchess2 for all sizes (see INFCHESS_SIZES in CMakeLists.txt) in the build directory
+# (default: build-bench_solve), passing every -D to cmake. Then every size is solved from scratch (infchess2 --size=<size>) with its data
+# in the scratch directory (default: <build directory>/bench_solve.data, which is removed after every solve),
+# and the "summary" line of the --metrics output (see PlyMetrics.h) is read. The columns of the table are:
+#
+#   classify_s     : the time it took to create the Graph and classify all positions.
+#   retrograde_s   : the time of the retrograde analysis (all ply).
+#   rss_MiB        : the peak resident set size.
+#   graph_B/pos    : the size of the Graph (Info and AuxiliaryInfo) per legal position.
+#   table_B/pos    : the size of the exported tablebase.dtm per legal position.
+#   layout         : the order of the squares of a block (row_major, or morton with -D INFCHESS_MORTON=ON).
+#   cache_miss%    : the last level cache misses of the retrograde analysis, as percentage of the references.
+#   dtlb_miss%     : the data TLB misses of the retrograde analysis, as percentage of the loads.
+#                    Both are "-" if the hardware counters aren't available (see HardwareCounters.h).
+#   legal .. stalemates, max_ply : the same counts as in src/README.max_ply.
+#
+# With -o the table is also written to <filename> as tab separated values. To compare the two layouts, run for example
+#
+#   src/version2/bench_solve.sh -B build-row_major 4x4x2x2 3x3x3x3
+#   src/version2/bench_solve.sh -B build-morton -D INFCHESS_MORTON=ON 4x4x2x2 3x3x3x3
+
+set -e
+
+source_directory="$(realpath "$(dirname "$0")/../..")"
+build_directory="build-bench_solve"
+scratch_directory=
+table_filename=
+cmake_options=()
+sizes=()
+infchess2_options=()
+
+usage()
+{
+  echo "Usage: $0 [-B <build directory>] [-D <VAR=VALUE>]... [-d <scratch directory>] [-o <filename>] <BXxBYxPXxPY>... [-- <infchess2 options>]" >&2
+  exit 1
+}
+
+while test $# -gt 0; do
+  case "$1" in
+    -B) test $# -gt 1 || usage; build_directory="$2"; shift 2;;
+    -D) test $# -gt 1 || usage; cmake_options+=("-D$2"); shift 2;;
+    -d) test $# -gt 1 || usage; scratch_directory="$2"; shift 2;;
+    -o) test $# -gt 1 || usage; table_filename="$2"; shift 2;;
+    --) shift; infchess2_options=("$@"); break;;
+    [0-9]*x[0-9]*x[0-9]*x[0-9]*) sizes+=("$1"); shift;;
+    *) usage;;
+  esac
+done
+test ${#sizes[@]} -gt 0 || usage
+build_directory="$(realpath -m "$build_directory")"
+scratch_directory="$(realpath -m "${scratch_directory:-$build_directory/bench_solve.data}")"
+
+# Configure and build all sizes at once.
+cmake -S "$source_directory" -B "$build_directory" "-DINFCHESS_SIZES=$(IFS=';'; echo "${sizes[*]}")" \
+  "${cmake_options[@]}" >/dev/null
+cmake --build "$build_directory" --parallel --target infchess2
+
+# Returns the value of "$1" in the JSON object $2 (empty if it isn't there).
+field()
+{
+  sed -n -e "s/.*\"$1\":\"\{0,1\}\([^,}\"]*\).*/\1/p" <<< "$2"
+}
+
+# Prints $1 as percentage of $2, or "-" if either is missing.
+percentage()
+{
+  if test -n "$1" -a -n "$2"; then
+    awk "BEGIN { if ($2 == 0) print \"-\"; else printf \"%.2f\", 100 * $1 / $2 }"
+  else
+    echo "-"
+  fi
+}
+
+columns=(board blocks block classify_s retrograde_s rss_MiB graph_B/pos table_B/pos layout cache_miss% dtlb_miss% legal draws black_in_check mates stalemates max_ply)
+rows=("$(IFS=$'\t'; echo "${columns[*]}")")
+for size in "${sizes[@]}"; do
+  rm -rf "$scratch_directory"
+  mkdir -p "$scratch_directory"
+  log="$scratch_directory.$size.log"
+  echo "*** Solving $size (output in $log)" >&2
+  if ! "$build_directory/src/version2/infchess2" --size="$size" --prefix="$scratch_directory" --no-checkpoints \
+      --metrics="$scratch_directory/metrics.jsonl" "${infchess2_options[@]}" > "$log" 2>&1; then
+    echo "*** infchess2 --size=$size failed; see $log" >&2
+    exit 1
+  fi
+  summary="$(grep '"type":"summary"' "$scratch_directory/metrics.jsonl")"
+  rm -rf "$scratch_directory"
+  if test -z "$summary"; then
+    echo "*** infchess2 --size=$size didn't write a summary; see $log" >&2
+    exit 1
+  fi
+
+  legal="$(field legal "$summary")"
+  rows+=("$(printf "%sx%s\t%sx%s\t%sx%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s" \
+    "$(field board_x "$summary")" "$(field board_y "$summary")" \
+    "$(field Px "$summary")" "$(field Py "$summary")" "$(field Bx "$summary")" "$(field By "$summary")" \
+    "$(field classify_s "$summary")" "$(field retrograde_s "$summary")" \
+    "$(awk "BEGIN { printf \"%.1f\", $(field peak_rss_kb "$summary") / 1024 }")" \
+    "$(awk "BEGIN { printf \"%.2f\", $(field graph_bytes "$summary") / $legal }")" \
+    "$(awk "BEGIN { printf \"%.2f\", $(field tablebase_bytes "$summary") / $legal }")" \
+    "$(field layout "$summary")" \
+    "$(percentage "$(field cache_misses "$summary")" "$(field cache_references "$summary")")" \
+    "$(percentage "$(field dtlb_load_misses "$summary")" "$(field dtlb_loads "$summary")")" \
+    "$legal" "$(field draws "$summary")" "$(field black_in_check "$summary")" \
+    "$(field mates "$summary")" "$(field stalemates "$summary")" "$(field max_ply "$summary")")")
+done
+
+# Align the columns.
+printf "%s\n" "${rows[@]}" | awk -F '\t' '
+  { for (i = 1; i <= NF; ++i) { cell[NR, i] = $i; if (length($i) > width[i]) width[i] = length($i) } }
+  END { for (r = 1; r <= NR; ++r) { for (i = 1; i <= NF; ++i) printf "%-*s%s", width[i], cell[r, i], (i < NF ? "  " : "\n") } }'
+if test -n "$table_filename"; then
+  printf "%s\n" "${rows[@]}" > "$table_filename"
+fi
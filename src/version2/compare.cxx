@@ -1,5 +1,6 @@
 #include "sys.h"
 #include "Uncompressed.h"
+#include "ProbeRingClient.h"
 #include "../Color.h"
 #include "utils/AIAlert.h"
 #include "utils/at_scope_end.h"
@@ -10,7 +11,11 @@
 #include <unistd.h>             // close()
 #include <stdexcept>            // std::runtime_error
 #include <string>               // std::string
+#include <string_view>          // std::string_view
 #include <cstring>              // strerror() and memset()
+#include <atomic>               // std::atomic
+#include <future>               // std::async
+#include <vector>               // std::vector
 #include "debug.h"
 
 class Server
@@ -29,7 +34,8 @@ class Server
     char const* ptr = static_cast<char const*>(buffer);
     while (len > 0)
     {
-      ssize_t bytes_sent = send(fd_, ptr, len, 0);
+      // Get EPIPE instead of SIGPIPE when the connection was closed.
+      ssize_t bytes_sent = send(fd_, ptr, len, MSG_NOSIGNAL);
       if (bytes_sent < 0)
       {
         // EINTR is a temporary interruption; we can just retry.
@@ -97,22 +103,33 @@ class Server
       close(fd_);
   }
 
+  // Make a send_request or recv_reply that is blocked in another thread fail (and all later ones).
+  void shutdown()
+  {
+    ::shutdown(fd_, SHUT_RDWR);
+  }
+
   // Disable copy constructor and copy assignment.
   Server(Server const&) = delete;
   Server& operator=(Server const&) = delete;
 
-  std::array<UncompressedInfo, 2> get_data(UncompressedBoard const& board)
+  // Send a request for all `boards`. Requests may be sent without waiting for the replies of the previous ones.
+  void send_request(uint32_t request_id, std::vector<UncompressedBoard> const& boards)
   {
-    // Send `board` in host order over the socket.
-    // We use a helper to ensure all data is sent, even if TCP sends it in chunks.
-    send_all(&board, sizeof(UncompressedBoard));
-
-    // Wait for sizeof(UncompressedInfo) bytes to be returned and interpret those as host order.
-    // We use a helper to ensure we read the entire message.
-    std::array<UncompressedInfo, 2> answer;
-    recv_all(answer.data(), sizeof(answer));
+    QueryHeader const header{QueryHeader::query_magic, request_id, static_cast<uint32_t>(boards.size())};
+    send_all(&header, sizeof(header));
+    send_all(boards.data(), boards.size() * sizeof(UncompressedBoard));
+  }
 
-    return answer;
+  // Receive the reply of the next request: two UncompressedInfo objects per board (black and white to move).
+  void recv_reply(uint32_t request_id, std::vector<UncompressedInfo>& infos)
+  {
+    ReplyHeader header;
+    recv_all(&header, sizeof(header));
+    if (header.magic != ReplyHeader::reply_magic || header.request_id != request_id)
+      THROW_ALERT("Unexpected reply from port [PORT]", AIArgs("[PORT]", port_));
+    infos.resize(2 * header.number_of_boards);
+    recv_all(infos.data(), infos.size() * sizeof(UncompressedInfo));
   }
 };
 
@@ -148,61 +165,142 @@ void diff_ply(UncompressedBoard const& p, Color to_move, int ply32, int ply64)
   }
 }
 
-int main()
+// Compare the results of both servers for `boards`.
+void compare_boards(std::vector<UncompressedBoard> const& boards,
+    std::vector<UncompressedInfo> const& infos32, std::vector<UncompressedInfo> const& infos64)
+{
+  for (size_t i = 0; i < boards.size(); ++i)
+  {
+    UncompressedBoard const& pieces = boards[i];
+    int const bkx = pieces.bkx, bky = pieces.bky, wkx = pieces.wkx, wky = pieces.wky, wrx = pieces.wrx, wry = pieces.wry;
+    UncompressedInfo const* data32 = &infos32[2 * i];
+    UncompressedInfo const* data64 = &infos64[2 * i];
+
+    ASSERT(data32[0].classification == data64[0].classification);
+    ASSERT(data32[1].classification == data64[1].classification);
+    if (data32[0].mate_in_ply_encoded != data64[0].mate_in_ply_encoded)
+    {
+      diff_ply(pieces, black, data32[0].mate_in_ply_encoded, data64[0].mate_in_ply_encoded);
+    }
+    //ASSERT(data32[0].mate_in_ply_encoded == data64[0].mate_in_ply_encoded);
+    if (data32[1].mate_in_ply_encoded > data64[1].mate_in_ply_encoded + 20)
+    {
+      diff_ply(pieces, white, data32[1].mate_in_ply_encoded, data64[1].mate_in_ply_encoded);
+    }
+    //ASSERT(data32[1].mate_in_ply_encoded == data64[1].mate_in_ply_encoded);
+    if (data32[0].number_of_children != data64[0].number_of_children)
+    {
+      Dout(dc::notice, "black king: " << bkx << ", " << bky << "; white king: " << wkx << ", " << wky << "; white rook: " << wrx << ", " << wry << ": data32[0].number_of_children = " << data32[0].number_of_children << " and data64[0].number_of_children = " << data64[0].number_of_children);
+    }
+    ASSERT(data32[0].number_of_children == data64[0].number_of_children);
+    if (data32[1].number_of_children > data64[1].number_of_children)
+    {
+      Dout(dc::notice, "black king: " << bkx << ", " << bky << "; white king: " << wkx << ", " << wky << "; white rook: " << wrx << ", " << wry << ": data32[1].number_of_children = " << data32[1].number_of_children << " and data64[1].number_of_children = " << data64[1].number_of_children);
+    }
+    ASSERT(data32[1].number_of_children <= data64[1].number_of_children);
+  }
+}
+
+// Returns all boards with the black king on (bkx, bky).
+std::vector<UncompressedBoard> make_boards(int bkx, int bky)
+{
+  std::vector<UncompressedBoard> boards;
+  boards.reserve(16 * 16 * 16 * 16);
+  for (int wkx = 0; wkx < 16; ++wkx)
+    for (int wky = 0; wky < 16; ++wky)
+      for (int wrx = 0; wrx < 16; ++wrx)
+        for (int wry = 0; wry < 16; ++wry)
+          boards.emplace_back(bkx, bky, wkx, wky, wrx, wry);
+  return boards;
+}
+
+int main(int argc, char* argv[])
 {
   Debug(NAMESPACE_DEBUG::init());
 
+  // With --shm the servers are accessed through shared memory (see ProbeRing.h).
+  bool const use_shm = argc == 2 && std::string_view{argv[1]} == "--shm";
+  if (argc > 1 && !use_shm)
+  {
+    std::cerr << "Usage: " << argv[0] << " [--shm]" << std::endl;
+    return 1;
+  }
+
   try
   {
+    if (use_shm)
+    {
+      ProbeRingClient r32(32, 32);
+      ProbeRingClient r64(64, 64);
+
+      std::vector<UncompressedInfo> infos32;
+      std::vector<UncompressedInfo> infos64;
+      for (int bkx = 5; bkx < 16; ++bkx)
+      {
+        for (int bky = 0; bky < 16; ++bky)
+        {
+          std::cout << "Testing bk " << bkx << ", " << bky << std::endl;
+          std::vector<UncompressedBoard> const boards = make_boards(bkx, bky);
+          infos32.resize(2 * boards.size());
+          infos64.resize(2 * boards.size());
+          r32.probe(boards.data(), boards.size(), infos32.data());
+          r64.probe(boards.data(), boards.size(), infos64.data());
+          compare_boards(boards, infos32, infos64);
+        }
+      }
+      return 0;
+    }
+
     Server s32(2032);
     Server s64(2064);
 
-    for (int bkx = 5; bkx < 16; ++bkx)
+    // Stream all requests from a separate thread, so that the servers never wait for us.
+    std::atomic<bool> send_failed = false;
+    auto sender = std::async(std::launch::async, [&]{
+      // If sending fails, make recv_reply below fail too, instead of waiting for replies that never come.
+      auto&& stop_receiving = at_scope_end([&]{ send_failed = true; s32.shutdown(); s64.shutdown(); });
+      uint32_t request_id = 0;
+      for (int bkx = 5; bkx < 16; ++bkx)
+        for (int bky = 0; bky < 16; ++bky, ++request_id)
+        {
+          std::vector<UncompressedBoard> const boards = make_boards(bkx, bky);
+          s32.send_request(request_id, boards);
+          s64.send_request(request_id, boards);
+        }
+      stop_receiving.disarm();
+    });
+    // If receiving fails, the destructor of `sender` waits for the sender; make it stop
+    // instead of staying blocked in send() to a server whose replies are no longer read.
+    auto&& stop_sending = at_scope_end([&]{ s32.shutdown(); s64.shutdown(); });
+
+    std::vector<UncompressedInfo> infos32;
+    std::vector<UncompressedInfo> infos64;
+    uint32_t request_id = 0;
+    try
     {
-      for (int bky = 0; bky < 16; ++bky)
+      for (int bkx = 5; bkx < 16; ++bkx)
       {
-        std::cout << "Testing bk " << bkx << ", " << bky << std::endl;
-        for (int wkx = 0; wkx < 16; ++wkx)
+        for (int bky = 0; bky < 16; ++bky, ++request_id)
         {
-          for (int wky = 0; wky < 16; ++wky)
-          {
-            for (int wrx = 0; wrx < 16; ++wrx)
-            {
-              for (int wry = 0; wry < 16; ++wry)
-              {
-                UncompressedBoard pieces(bkx, bky, wkx, wky, wrx, wry);
-                std::array<UncompressedInfo, 2> data32 = s32.get_data(pieces);
-                std::array<UncompressedInfo, 2> data64 = s64.get_data(pieces);
-
-                ASSERT(data32[0].classification == data64[0].classification);
-                ASSERT(data32[1].classification == data64[1].classification);
-                if (data32[0].mate_in_ply_encoded != data64[0].mate_in_ply_encoded)
-                {
-                  diff_ply(pieces, black, data32[0].mate_in_ply_encoded, data64[0].mate_in_ply_encoded);
-                }
-                //ASSERT(data32[0].mate_in_ply_encoded == data64[0].mate_in_ply_encoded);
-                if (data32[1].mate_in_ply_encoded > data64[1].mate_in_ply_encoded + 20)
-                {
-                  diff_ply(pieces, white, data32[1].mate_in_ply_encoded, data64[1].mate_in_ply_encoded);
-                }
-                //ASSERT(data32[1].mate_in_ply_encoded == data64[1].mate_in_ply_encoded);
-                if (data32[0].number_of_children != data64[0].number_of_children)
-                {
-                  Dout(dc::notice, "black king: " << bkx << ", " << bky << "; white king: " << wkx << ", " << wky << "; white rook: " << wrx << ", " << wry << ": data32[0].number_of_children = " << data32[0].number_of_children << " and data64[0].number_of_children = " << data64[0].number_of_children);
-                }
-                ASSERT(data32[0].number_of_children == data64[0].number_of_children);
-                if (data32[1].number_of_children > data64[1].number_of_children)
-                {
-                  Dout(dc::notice, "black king: " << bkx << ", " << bky << "; white king: " << wkx << ", " << wky << "; white rook: " << wrx << ", " << wry << ": data32[1].number_of_children = " << data32[1].number_of_children << " and data64[1].number_of_children = " << data64[1].number_of_children);
-                }
-                ASSERT(data32[1].number_of_children <= data64[1].number_of_children);
-              }
-            }
-          }
+          std::cout << "Testing bk " << bkx << ", " << bky << std::endl;
+          std::vector<UncompressedBoard> const boards = make_boards(bkx, bky);
+          s32.recv_reply(request_id, infos32);
+          s64.recv_reply(request_id, infos64);
+          compare_boards(boards, infos32, infos64);
         }
       }
     }
+    catch (AIAlert::Error const&)
+    {
+      // If the sender failed first then receiving failed because of that; report the error of the sender.
+      if (send_failed)
+        sender.get();
+      throw;
+    }
+    stop_sending.disarm();
 
+    // Rethrow a possible exception of the sender.
+    sender.get();
   }
   catch (AIAlert::Error const& error)
   {
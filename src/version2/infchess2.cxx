@@ -1,27 +1,108 @@
 #include "sys.h"
 #include "Graph.h"
+#include "Frontier.h"
+#include "Checkpoint.h"
+#include "UpdateBuckets.h"
+#include "PartitionScheduler.h"
+#include "PlyMetrics.h"
+#include "Trace.h"
+#include "Tablebase.h"
+#include "SizeRegistry.h"
 #include "../parse_move.h"
 #include "utils/AIAlert.h"
 #include "utils/debug_ostream_operators.h"
-#include "utils/threading/Gate.h"
-#include "utils/itoa.h"
 #include "threadpool/AIThreadPool.h"
 #include <bitset>
-#include <set>
+#include <charconv>
+#include <memory>
+#include <optional>
+#include <string_view>
 #include "debug.h"
 
-int main()
+inline namespace SIZE_NAMESPACE {
+
+// The main function of infchess2 for one size (see SizeRegistry.h).
+int solve(int argc, char* argv[])
 {
-  Debug(NAMESPACE_DEBUG::init());
+  // Command line options.
+  bool owner_computes = false;          // Bucket the parent updates per partition, see UpdateBuckets.h.
+  bool resume = false;                  // Continue from the last Checkpoint.
+  bool write_checkpoints = true;        // Write a Checkpoint at the start of every ply.
+  bool huge_pages = false;              // Ask for huge pages for the Graph, see HugePages.h.
+  size_t memory_budget = 0;             // The maximum working set in bytes while processing a ply (zero is unlimited), see PartitionScheduler.h.
+  std::optional<size_t> auxiliary_budget;       // The maximum size in bytes of the anonymous AuxiliaryInfo (default: memory_budget), see ScratchMemory.h.
+  std::filesystem::path metrics_filename;       // If not empty, write per-ply metrics to this file, see PlyMetrics.h.
+  std::filesystem::path trace_filename;         // If not empty, write a timeline of all tasks to this file, see Trace.h.
+  std::filesystem::path prefix_directory = "/opt/ext4/nvme1/infchessKRvK";     // See Graph::data_directory.
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string_view const arg = argv[i];
+    std::string_view const memory_budget_option = "--memory-budget=";
+    std::string_view const auxiliary_budget_option = "--auxiliary-budget=";
+    std::string_view const metrics_option = "--metrics=";
+    std::string_view const trace_option = "--trace=";
+    std::string_view const prefix_option = "--prefix=";
+    size_t budget_mb;
+    if (arg.starts_with(memory_budget_option) &&
+        std::from_chars(arg.data() + memory_budget_option.size(), arg.data() + arg.size(), budget_mb).ec == std::errc{})
+      memory_budget = budget_mb << 20;
+    else if (arg.starts_with(auxiliary_budget_option) &&
+        std::from_chars(arg.data() + auxiliary_budget_option.size(), arg.data() + arg.size(), budget_mb).ec == std::errc{})
+      auxiliary_budget = budget_mb << 20;
+    else if (arg.starts_with(metrics_option) && arg.size() > metrics_option.size())
+      metrics_filename = arg.substr(metrics_option.size());
+    else if (arg.starts_with(trace_option) && arg.size() > trace_option.size())
+      trace_filename = arg.substr(trace_option.size());
+    else if (arg.starts_with(prefix_option) && arg.size() > prefix_option.size())
+      prefix_directory = arg.substr(prefix_option.size());
+    else if (arg == "--owner-computes")
+      owner_computes = true;
+    else if (arg == "--resume")
+      resume = true;
+    else if (arg == "--no-checkpoints")
+      write_checkpoints = false;
+    else if (arg == "--huge-pages")
+      huge_pages = true;
+    else
+    {
+      std::cerr << "Usage: " << argv[0] << " [--size=<BXxBYxPXxPY>] [--owner-computes] [--resume] [--no-checkpoints] [--huge-pages] [--memory-budget=<MiB>] [--auxiliary-budget=<MiB>] [--metrics=<filename>] [--trace=<filename>] [--prefix=<directory>]" << std::endl;
+      return 1;
+    }
+  }
+  if (owner_computes && memory_budget > 0)
+  {
+    // The apply step of UpdateBuckets already works on one partition at a time.
+    std::cerr << "--memory-budget can not be combined with --owner-computes." << std::endl;
+    return 1;
+  }
 
   constexpr int max_number_of_tasks = 200;
-  constexpr int min_number_of_parents_per_task = 100;
+  constexpr int number_of_threads = 32;
 
-  AIThreadPool thread_pool(32);
+  if (!trace_filename.empty())
+    Trace::start(trace_filename);
+
+  AIThreadPool thread_pool(number_of_threads);
   AIQueueHandle queue_handle = thread_pool.new_queue(max_number_of_tasks + 1);
 
   Dout(dc::notice, "sizeof(Info) = " << sizeof(Info));
 
+  // Print how long the tasks of the last ply had nothing to do.
+  auto print_idle_time = [](ChunkedRunTimes const& times){
+    auto const idle_ms = std::chrono::duration_cast<std::chrono::microseconds>(times.idle_time()).count() / 1000.0;
+    auto const wall_ms = std::chrono::duration_cast<std::chrono::microseconds>(times.wall_time).count() / 1000.0;
+    std::cout << "  wall time: " << wall_ms << " ms; idle: " << idle_ms << " ms (" <<
+      (100.0 * times.idle_fraction()) << "% of " << times.busy_time.size() << " tasks)." << std::endl;
+  };
+
+  // Print how much of the Graph that is in memory is mapped with huge pages.
+  auto print_huge_page_coverage = [](Graph& graph){
+    for (auto [name, coverage] : { std::pair{"Info", graph.infos_huge_page_coverage()},
+        std::pair{"AuxiliaryInfo", graph.auxiliary_infos_huge_page_coverage()} })
+      std::cout << "  huge pages: " << (100.0 * coverage.fraction()) << "% of " << (coverage.resident >> 20) <<
+        " MiB resident " << name << "." << std::endl;
+  };
+
   // Get the size of the board.
   int const board_size_x = Size::board::x;
   int const board_size_y = Size::board::y;
@@ -39,10 +120,12 @@ int main()
     // Construct the initial graph with all positions that are already mate.
     auto start = std::chrono::high_resolution_clock::now();
 
-    std::filesystem::path const prefix_directory = "/opt/ext4/nvme1/infchessKRvK";
     std::filesystem::path const data_directory = Graph::data_directory(prefix_directory);
     std::filesystem::path const data_filename = Graph::data_filename(prefix_directory);
+    std::filesystem::path const checkpoint_filename = Checkpoint::filename(data_directory);
     bool const file_exists = std::filesystem::exists(data_filename);
+    if (resume && !(file_exists && std::filesystem::exists(checkpoint_filename)))
+      THROW_ALERT("There is no checkpoint to resume from in [DIRECTORY]", AIArgs("[DIRECTORY]", data_directory));
     if (!file_exists)
     {
       std::filesystem::path const directory_path = data_filename.parent_path();
@@ -59,19 +142,34 @@ int main()
       Dout(dc::notice, "Using existing file " << data_filename << ".");
 
     // Only a new file is zero initialized.
-    Graph graph(prefix_directory, file_exists);
+    Graph graph(prefix_directory, file_exists, false, auxiliary_budget.value_or(memory_budget));
+    if (huge_pages)
+    {
+      // Anonymous memory and tmpfs (mounted with huge=advise or huge=within_size) can get huge pages;
+      // a file on a regular file system gets normal pages, which is reported as 0% coverage below.
+      if (graph.advise_huge_pages())
+        std::cout << "Requested huge pages (transparent_hugepage/enabled: " << HugePages::mode() <<
+          ", shmem_enabled: " << HugePages::mode("shmem_enabled") << ")." << std::endl;
+      else
+      {
+        std::cout << "This kernel does not support transparent huge pages; using normal pages." << std::endl;
+        huge_pages = false;
+      }
+    }
     std::vector<Board> already_mate;
+    PlyMetrics::PositionCounts position_counts;
+
+    std::unique_ptr<PlyMetrics> metrics;
+    if (!metrics_filename.empty())
+      metrics = std::make_unique<PlyMetrics>(metrics_filename, number_of_threads);
 
     if (!file_exists)
     {
-      int total_positions;
-      int draw_positions = 0;
-      int black_in_check_positions = 0;
-      int mate_positions = 0;
-      int stalemate_positions = 0;
-
       // Generate all possible positions.
-      graph.classify();
+      {
+        TraceScope trace_scope("phase", "classify");
+        graph.classify(thread_pool, queue_handle, max_number_of_tasks);
+      }
 
       Dout(dc::notice, "Number of partitions: white: " << graph.white_to_move_infos().size() <<
           ", black: " << graph.black_to_move_infos().size());
@@ -80,7 +178,6 @@ int main()
       Dout(dc::notice, "Processing Black-To-Move-Partitions...");
       {
         auto const& black_to_move_infos = graph.black_to_move_infos();
-        total_positions = 0;
         for (Partition current_partition = black_to_move_infos.ibegin();
             current_partition != black_to_move_infos.iend(); ++current_partition)
         {
@@ -92,18 +189,21 @@ int main()
             Classification const& pc = info.classification();
             if (!pc.is_legal())
               continue;
-            ++total_positions;
+            Board const board(current_partition, current_partition_element);
+            // A canonical board also stands for its mirror image (unless it is its own mirror image).
+            int const weight = (Size::diagonal_symmetry && !board.is_symmetric()) ? 2 : 1;
+            position_counts.legal += weight;
             if (pc.is_draw())
-              ++draw_positions;
+              position_counts.draws += weight;
             if (pc.is_check())
-              ++black_in_check_positions;
+              position_counts.black_in_check += weight;
             if (pc.is_mate())
             {
-              ++mate_positions;
-              already_mate.emplace_back(current_partition, current_partition_element);
+              position_counts.mates += weight;
+              already_mate.push_back(board);
             }
             if (pc.is_stalemate())
-              ++stalemate_positions;
+              position_counts.stalemates += weight;
           }
         }
       }
@@ -122,22 +222,29 @@ int main()
             Classification const& pc = info.classification();
             if (!pc.is_legal())
               continue;
-            ++total_positions;
+            Board const board(current_partition, current_partition_element);
+            int const weight = (Size::diagonal_symmetry && !board.is_symmetric()) ? 2 : 1;
+            position_counts.legal += weight;
             if (pc.is_draw())
-              ++draw_positions;
+              position_counts.draws += weight;
           }
         }
       }
 
       std::cout << "Version 2:" << std::endl;
-      std::cout << "Total legal positions: " << total_positions << std::endl;
-      std::cout << "Draw positions: " << draw_positions << std::endl;
-      std::cout << "Black in check positions: " << black_in_check_positions << std::endl;
-      std::cout << "Mate positions: " << mate_positions << std::endl;
-      std::cout << "Stalemate positions: " << stalemate_positions << std::endl;
+      std::cout << "Total legal positions: " << position_counts.legal << std::endl;
+      std::cout << "Draw positions: " << position_counts.draws << std::endl;
+      std::cout << "Black in check positions: " << position_counts.black_in_check << std::endl;
+      std::cout << "Mate positions: " << position_counts.mates << std::endl;
+      std::cout << "Stalemate positions: " << position_counts.stalemates << std::endl;
     }
-    else
+    else if (!resume)
     {
+      // Only canonical boards are stored; the other half are the mirror images of those.
+      auto add_mate = [&already_mate](Board board){
+        if (board.is_canonical())
+          already_mate.push_back(board);
+      };
       // Generate all positions that are already mate.
       for (int x = 0; x < Size::board_size_x; ++x)
       {
@@ -145,9 +252,9 @@ int main()
         {
           if (std::abs(wx - x) > 1)
           {
-            already_mate.emplace_back(BlackKingSquare{x, 0}, WhiteKingSquare{x, 2}, WhiteRookSquare{wx, 0});
+            add_mate({BlackKingSquare{x, 0}, WhiteKingSquare{x, 2}, WhiteRookSquare{wx, 0}});
             if (x == 0)
-              already_mate.emplace_back(BlackKingSquare{x, 0}, WhiteKingSquare{1, 2}, WhiteRookSquare{wx, 0});
+              add_mate({BlackKingSquare{x, 0}, WhiteKingSquare{1, 2}, WhiteRookSquare{wx, 0}});
           }
         }
       }
@@ -157,9 +264,9 @@ int main()
         {
           if (std::abs(wy - y) > 1)
           {
-            already_mate.emplace_back(BlackKingSquare{0, y}, WhiteKingSquare{2, y}, WhiteRookSquare{0, wy});
+            add_mate({BlackKingSquare{0, y}, WhiteKingSquare{2, y}, WhiteRookSquare{0, wy}});
             if (y == 0)
-              already_mate.emplace_back(BlackKingSquare{0, y}, WhiteKingSquare{2, 1}, WhiteRookSquare{0, wy});
+              add_mate({BlackKingSquare{0, y}, WhiteKingSquare{2, 1}, WhiteRookSquare{0, wy}});
           }
         }
       }
@@ -168,14 +275,18 @@ int main()
 
     auto end = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-    std::cout << "Execution time: " << (duration.count() / 1000000.0) << " seconds\n";
+    double const classify_seconds = duration.count() / 1000000.0;
+    std::cout << "Execution time: " << classify_seconds << " seconds\n";
+    if (huge_pages)
+      print_huge_page_coverage(graph);
 
-    if (file_exists)
+    if (file_exists && !resume)
     {
       Dout(dc::notice|continued_cf|flush_cf, "Resetting ply to unknown...");
       // Reset all ply to zero so we can test the code below.
       //FIXME: remove this.
-      graph.reset_ply();
+      TraceScope trace_scope("phase", "reset_ply");
+      graph.reset_ply(thread_pool, queue_handle, max_number_of_tasks);
       Dout(dc::finish, " done");
     }
 
@@ -194,16 +305,37 @@ int main()
     }
 #endif
 
-    // Run over all positions that are already mate (as per the classification)
-    // and mark all position that can reach those as mate in 1 ply.
-    std::vector<Board> white_to_move_parents;
-    std::cout << "Setting ply to 0 for " << already_mate.size() << " positions." << std::endl;
-    for (Board current_board : already_mate)
+    Frontier white_to_move_parents;
+    Frontier black_to_move_parents;
+    // The positions in the frontier of `to_move` are mate in `ply` ply.
+    int ply = 1;
+    Color to_move = white;
+
+    if (resume)
+    {
+      Frontier frontier;
+      Checkpoint const checkpoint = Checkpoint::read(checkpoint_filename, frontier);
+      ply = checkpoint.ply();
+      to_move = checkpoint.to_move();
+      (to_move == white ? white_to_move_parents : black_to_move_parents) = std::move(frontier);
+      std::cout << "Resuming at ply " << ply << " with " << to_move << " to move." << std::endl;
+      // Undo what the interrupted ply might have written and restore the AuxiliaryInfo.
+      TraceScope trace_scope("phase", "rollback_to_ply");
+      graph.rollback_to_ply(thread_pool, queue_handle, max_number_of_tasks, ply);
+    }
+    else
     {
-//      current_board.debug_utf8art(DEBUGCHANNELS::dc::notice);
-      Info& black_to_move_info = graph.get_info<black>(current_board);
-      black_to_move_info.classification().set_mate_in_ply(0);
-      black_to_move_info.black_to_move_set_maximum_ply_on_parents(current_board, graph, white_to_move_parents);
+      // Run over all positions that are already mate (as per the classification)
+      // and mark all position that can reach those as mate in 1 ply.
+      std::cout << "Setting ply to 0 for " << already_mate.size() << " positions." << std::endl;
+      TraceScope trace_scope("phase", "ply 0");
+      for (Board current_board : already_mate)
+      {
+//        current_board.debug_utf8art(DEBUGCHANNELS::dc::notice);
+        Info& black_to_move_info = graph.get_info<black>(current_board);
+        black_to_move_info.classification().set_mate_in_ply(0);
+        black_to_move_info.black_to_move_set_maximum_ply_on_parents(current_board, graph, white_to_move_parents);
+      }
     }
 
     // Measure the time it takes to generate the graph.
@@ -211,230 +343,136 @@ int main()
 
     Board initial_position;
     Color initial_to_move;
+    int max_ply;
     {
-      // white_to_move_parents are mate in `ply` moves.
-      int ply = 0;
-      while (!white_to_move_parents.empty())
+      UpdateBuckets update_buckets(number_of_threads);
+      PartitionScheduler partition_scheduler(memory_budget);
+      bool just_resumed = resume;
+      // Whether everything that this process changed before the current ply is on disk.
+      bool synced_all = false;
+      while (!(to_move == white ? white_to_move_parents : black_to_move_parents).empty())
       {
-        ++ply;
-        std::vector<Board> black_to_move_parents;
-        // Run over all positions that are mate in an odd number of ply.
+        Frontier& children = (to_move == white) ? white_to_move_parents : black_to_move_parents;
+        Frontier& parents = (to_move == white) ? black_to_move_parents : white_to_move_parents;
+        initial_position = children.front();
+        initial_to_move = to_move;
+        TraceScope ply_trace_scope("ply", "ply " + std::to_string(ply) + (to_move == white ? " (white)" : " (black)"));
+
+        if (write_checkpoints && !just_resumed)
         {
-          Dout(dc::notice, "BEGIN white_to_move_parents immutable");
-          int const number_of_parents = white_to_move_parents.size();
-          // Round the number of tasks down, so we never have less than min_number_of_parents_per_task parents per task
-          // (unless number_of_parents < min_number_of_parents_per_task).
-          int const number_of_tasks = std::clamp(number_of_parents / min_number_of_parents_per_task, 1, max_number_of_tasks);
-          // Round up, so that number_of_tasks tasks is sufficient to process all number_of_parents parents.
-          int const number_of_parents_per_task = (number_of_parents + number_of_tasks - 1) / number_of_tasks;
-          std::array<std::vector<Board>, max_number_of_tasks> task_black_to_move_parentss;
-          // Distribute parents across exactly number_of_tasks tasks.
-          // Each task gets either base or base+1 parents so the sum equals number_of_parents.
-          int const base = number_of_parents / number_of_tasks;
-          int const rem  = number_of_parents % number_of_tasks;
-          std::cout << "Setting ply to " << ply << "/" << static_cast<uint32_t>(Classification::max_ply_upperbound) <<
-            " for up to " << number_of_parents << " positions using " << number_of_tasks << " tasks." << std::endl;
-          utils::threading::Gate until_all_tasks_finished;
-          std::atomic_int unfinished_tasks = number_of_tasks;
-          for (int task_n = 0; task_n < number_of_tasks; ++task_n)
+          // Everything up till this ply must be on disk before the checkpoint is written.
+          // The first time that includes the classification (or the rollback, after resuming); after that the
+          // previous ply only changed the Info of the positions in `children`, so only their partitions are synced.
+          TraceScope trace_scope("phase", "checkpoint");
+          if (synced_all)
+            graph.sync(to_move, children.used_partitions());
+          else
+            graph.sync();
+          synced_all = true;
+          Checkpoint{ply, to_move}.write(checkpoint_filename, children);
+        }
+        just_resumed = false;
+
+        std::cout << "Setting ply to " << ply << "/" << static_cast<uint32_t>(Classification::max_ply_upperbound) <<
+          " for up to " << children.size() << " positions." << std::endl;
+        if (metrics)
+          metrics->begin_ply(ply, to_move, children.size());
+        ChunkedRunTimes times;
+        if (to_move == white)
+        {
+          // Run over all positions that are mate in an odd number of ply.
+          if (owner_computes)
           {
-            int const parent_start = task_n * base + std::min(task_n, rem);
-            int const parents_this_task = base + (task_n < rem ? 1 : 0);
-            int const parent_end = std::min(parent_start + parents_this_task, number_of_parents);
-            //Dout(dc::notice, "PROCESSING task " << task_n << ": parent_start = " << parent_start << ", parent_end = " << parent_end);
-            ASSERT(parents_this_task > 0);
-            std::vector<Board>& task_black_to_move_parents = task_black_to_move_parentss[task_n];
-            auto task = [parent_start, parent_end, ply,
-                 &white_to_move_parents, &task_black_to_move_parents, &graph, &unfinished_tasks, &until_all_tasks_finished](){
-              for (int parent = parent_start; parent < parent_end; ++parent)
-              {
-                //Dout(dc::notice, "PROCESSING parent " << parent);
-                Board white_to_move_board = white_to_move_parents[parent];
-                // Access a non-const Info unique for this thread.
-                Info& white_to_move_info = graph.get_info<white>(white_to_move_board);
-                // All returned parents should be legal.
-                ASSERT(white_to_move_info.classification().is_legal());
-                ASSERT(white_to_move_info.classification().ply() == ply);
-                white_to_move_info.white_to_move_set_minimum_ply_on_parents(white_to_move_board, graph, task_black_to_move_parents);
-              }
-              // If this was the last one, open the 'until_all_tasks_finished' gate.
-              if (unfinished_tasks-- == 1)
-                until_all_tasks_finished.open();
-              // We're done.
-              return false;
-            };
-            {
-              // Get read access to AIThreadPool::m_queues.
-              auto queues_access = thread_pool.queues_read_access();
-              // Get a reference to one of the queues in m_queues.
-              auto& queue = thread_pool.get_queue(queues_access, queue_handle);
-              bool queue_full;
-              {
-                // Get producer accesses to this queue.
-                auto queue_access = queue.producer_access();
-                int length = queue_access.length();
-                queue_full = length == queue.capacity();
-                // I thought the queue was large enough?!
-                ASSERT(!queue_full);
-                if (!queue_full)
-                {
-                  // Place a lambda in the queue.
-                  //Dout(dc::notice, "Adding task " << task_n);
-                  queue_access.move_in(task);
-                }
-              } // Release producer accesses, so another thread can write to this queue again.
-              // This function must be called every time move_in was called
-              // on a queue that was returned by thread_pool.get_queue.
-              if (!queue_full) // Was move_in called?
-                queue.notify_one();
-            } // Release read access to AIThreadPool::m_queues so another thread can use AIThreadPool::new_queue again.
+            times = update_buckets.collect<white>(thread_pool, queue_handle, graph, ply, children);
+            print_idle_time(times);
+            ChunkedRunTimes const apply_times = update_buckets.apply<white>(thread_pool, queue_handle, graph, ply, parents);
+            print_idle_time(apply_times);
+            times += apply_times;
           }
-          Dout(dc::notice, "Waiting for all tasks to finish...");
-          until_all_tasks_finished.wait();
-#ifdef CWDEBUG
-          std::set<Board> black_to_move_parents_set;
-#endif
-          for (int task_n = 0; task_n < number_of_tasks; ++task_n)
+          else
           {
-            std::vector<Board> const& task_black_to_move_parents = task_black_to_move_parentss[task_n];
-            // Append task_black_to_move_parents to black_to_move_parents.
-            std::ranges::copy(task_black_to_move_parents, std::back_inserter(black_to_move_parents));
-#ifdef CWDEBUG
-            // Check that there are no duplicates.
-            for (auto&& board : task_black_to_move_parents)
-            {
-              auto ibp = black_to_move_parents_set.insert(board);
-              ASSERT(ibp.second);
-            }
-#endif
+            // Use one task per thread: every task keeps taking chunks of work until none are left.
+            times = partition_scheduler.for_each(thread_pool, queue_handle, number_of_threads, graph, white, children,
+                [ply, &parents, &graph](int /*task_n*/, Board white_to_move_board){
+                  // Access a non-const Info unique for this thread.
+                  Info& white_to_move_info = graph.get_info<white>(white_to_move_board);
+                  // All returned parents should be legal.
+                  ASSERT(white_to_move_info.classification().is_legal());
+                  ASSERT(white_to_move_info.classification().ply() == ply);
+                  white_to_move_info.white_to_move_set_minimum_ply_on_parents(white_to_move_board, graph, parents);
+                });
+            print_idle_time(times);
           }
-          Dout(dc::notice, "END white_to_move_parents immutable");
-        }
-
-        if (!black_to_move_parents.empty())
-        {
-          initial_position = black_to_move_parents[0];
-          initial_to_move = black;
         }
         else
-          break;
-
-        ++ply;
-        white_to_move_parents.clear();
-        // Run over all positions that are mate in an even number of ply.
         {
-          int const number_of_parents = black_to_move_parents.size();
-          // Round the number of tasks down, so we never have less than min_number_of_parents_per_task parents per task
-          // (unless number_of_parents < min_number_of_parents_per_task).
-          int const number_of_tasks = std::clamp(number_of_parents / min_number_of_parents_per_task, 1, max_number_of_tasks);
-          // Round up, so that number_of_tasks tasks is sufficient to process all number_of_parents parents.
-          int const number_of_parents_per_task = (number_of_parents + number_of_tasks - 1) / number_of_tasks;
-          std::array<std::vector<Board>, max_number_of_tasks> task_white_to_move_parentss;
-          // Distribute parents across exactly number_of_tasks tasks.
-          // Each task gets either base or base+1 parents so the sum equals number_of_parents.
-          int const base = number_of_parents / number_of_tasks;
-          int const rem  = number_of_parents % number_of_tasks;
-          std::cout << "Setting ply to " << ply << "/" << static_cast<uint32_t>(Classification::max_ply_upperbound) <<
-            " for up to " << number_of_parents << " positions using " << number_of_tasks << " tasks." << std::endl;
-          utils::threading::Gate until_all_tasks_finished;
-          std::atomic_int unfinished_tasks = number_of_tasks;
-          for (int task_n = 0; task_n < number_of_tasks; ++task_n)
+          // Run over all positions that are mate in an even number of ply.
+          if (owner_computes)
           {
-            int const parent_start = task_n * base + std::min(task_n, rem);
-            int const parents_this_task = base + (task_n < rem ? 1 : 0);
-            int const parent_end = std::min(parent_start + parents_this_task, number_of_parents);
-            Dout(dc::notice, "PROCESSING task " << task_n << ": parent_start = " << parent_start << ", parent_end = " << parent_end);
-            ASSERT(parents_this_task > 0);
-            std::vector<Board>& task_white_to_move_parents = task_white_to_move_parentss[task_n];
-            auto task = [parent_start, parent_end, ply,
-                 &black_to_move_parents, &task_white_to_move_parents, &graph, &unfinished_tasks, &until_all_tasks_finished](){
-              for (int parent = parent_start; parent < parent_end; ++parent)
-              {
-                Board black_to_move_board = black_to_move_parents[parent];
-                // Access a non-const Info unique for this thread.
-                Info& black_to_move_info = graph.get_info<black>(black_to_move_board);
-                // All returned parents should be legal.
-                ASSERT(black_to_move_info.classification().is_legal());
-                ASSERT(black_to_move_info.classification().ply() == ply);
-                black_to_move_info.black_to_move_set_maximum_ply_on_parents(black_to_move_board, graph, task_white_to_move_parents);
-              }
-              // If this was the last one, open the 'until_all_tasks_finished' gate.
-              if (unfinished_tasks-- == 1)
-                until_all_tasks_finished.open();
-              // We're done.
-              return false;
-            };
-            {
-              // Get read access to AIThreadPool::m_queues.
-              auto queues_access = thread_pool.queues_read_access();
-              // Get a reference to one of the queues in m_queues.
-              auto& queue = thread_pool.get_queue(queues_access, queue_handle);
-              bool queue_full;
-              {
-                // Get producer accesses to this queue.
-                auto queue_access = queue.producer_access();
-                int length = queue_access.length();
-                queue_full = length == queue.capacity();
-                // I thought the queue was large enough?!
-                ASSERT(!queue_full);
-                if (!queue_full)
-                {
-                  // Place a lambda in the queue.
-                  queue_access.move_in(task);
-                }
-              } // Release producer accesses, so another thread can write to this queue again.
-              // This function must be called every time move_in was called
-              // on a queue that was returned by thread_pool.get_queue.
-              if (!queue_full) // Was move_in called?
-                queue.notify_one();
-            } // Release read access to AIThreadPool::m_queues so another thread can use AIThreadPool::new_queue again.
+            times = update_buckets.collect<black>(thread_pool, queue_handle, graph, ply, children);
+            print_idle_time(times);
+            ChunkedRunTimes const apply_times = update_buckets.apply<black>(thread_pool, queue_handle, graph, ply, parents);
+            print_idle_time(apply_times);
+            times += apply_times;
           }
-          until_all_tasks_finished.wait();
-          std::set<Board> white_to_move_parents_set;
-          for (int task_n = 0; task_n < number_of_tasks; ++task_n)
+          else
           {
-            std::vector<Board> const& task_white_to_move_parents = task_white_to_move_parentss[task_n];
-            // Append task_white_to_move_parents to white_to_move_parents.
-            std::ranges::copy(task_white_to_move_parents, std::back_inserter(white_to_move_parents));
-#ifdef CWDEBUG
-            for (auto&& board : task_white_to_move_parents)
-            {
-              auto ibp = white_to_move_parents_set.insert(board);
-              if (!ibp.second)
-              {
-                NAMESPACE_DEBUG::Mark m;
-                Dout(dc::notice, "task_n: " << task_n << "; the board " << board << " was already added!");
-                Dout(dc::notice, "number_of_tasks = " << number_of_tasks);
-                std::array<char, 12> buf;
-                for (int task_n2 = 0; task_n2 < number_of_tasks; ++task_n2)
-                {
-                  std::vector<Board> const& task_white_to_move_parents2 = task_white_to_move_parentss[task_n2];
-                  Dout(dc::notice, "parents from task " << task_n2 << ": ");
-                  NAMESPACE_DEBUG::Mark m2(utils::itoa(buf, task_n2));
-                  for (Board b : task_white_to_move_parents2)
-                    Dout(dc::notice, b);
-                }
-              }
-              ASSERT(ibp.second);
-            }
-#endif
+            times = partition_scheduler.for_each(thread_pool, queue_handle, number_of_threads, graph, black, children,
+                [ply, &parents, &graph](int /*task_n*/, Board black_to_move_board){
+                  // Access a non-const Info unique for this thread.
+                  Info& black_to_move_info = graph.get_info<black>(black_to_move_board);
+                  // All returned parents should be legal.
+                  ASSERT(black_to_move_info.classification().is_legal());
+                  ASSERT(black_to_move_info.classification().ply() == ply);
+                  black_to_move_info.black_to_move_set_maximum_ply_on_parents(black_to_move_board, graph, parents);
+                });
+            print_idle_time(times);
           }
         }
+        if (memory_budget > 0)
+          std::cout << "  processed in " << partition_scheduler.number_of_groups() << " partition group(s)." << std::endl;
+        if (metrics)
+          metrics->end_ply(times);
+        children.clear();
 
-        if (!white_to_move_parents.empty())
-        {
-          initial_position = white_to_move_parents[0];
-          initial_to_move = white;
-        }
+        to_move = to_move.opponent();
+        ++ply;
       }
-      std::cout << "max ply = " << ply << std::endl;
+      max_ply = ply - 1;
+      std::cout << "max ply = " << max_ply << std::endl;
+      // The solve is complete; a checkpoint is no longer needed.
+      std::filesystem::remove(checkpoint_filename);
     }
 
     end = std::chrono::high_resolution_clock::now();
     duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-    std::cout << "Execution time: " << (duration.count() / 1000000.0) << " seconds\n";
+    double const retrograde_seconds = duration.count() / 1000000.0;
+    std::cout << "Execution time: " << retrograde_seconds << " seconds\n";
+    if (huge_pages)
+      print_huge_page_coverage(graph);
     std::cout << "Data written to " << data_filename << std::endl;
 
+    // Export the compact, read-only table that is used by mmap_server.
+    std::filesystem::path const tablebase_filename = Tablebase::filename(data_directory);
+    {
+      TraceScope trace_scope("phase", "export");
+      Tablebase::export_graph(graph, tablebase_filename);
+    }
+    std::cout << "Tablebase written to " << tablebase_filename << std::endl;
+
+    if (metrics)
+    {
+      size_t const graph_bytes = std::filesystem::file_size(data_filename) + graph.auxiliary_infos_bytes();
+      metrics->end_run({classify_seconds, retrograde_seconds, max_ply, graph_bytes,
+          std::filesystem::file_size(tablebase_filename), file_exists ? nullptr : &position_counts});
+    }
+
+    if (!trace_filename.empty())
+    {
+      Trace::stop();
+      std::cout << "Trace written to " << trace_filename << std::endl;
+    }
+
     return 0;
 
 #if 0
@@ -529,5 +567,10 @@ int main()
   catch (AIAlert::Error const& error)
   {
     std::cerr << "Fatal error: " << error << std::endl;
+    return 1;
   }
 }
+
+SizeRegistry::Registration const registration(Size::Bx, Size::By, Size::Px, Size::Py, &solve);
+
+} // namespace SIZE_NAMESPACE
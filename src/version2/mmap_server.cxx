@@ -1,80 +1,51 @@
 #include "sys.h"
 #include "utils/AIAlert.h"
 #include "utils/debug_ostream_operators.h"
-#include "utils/at_scope_end.h"
 #include "Graph.h"
+#include "Tablebase.h"
+#include "QueryServer.h"
+#include "ProbeRingServer.h"
 #include "Uncompressed.h"
-#include <cstring>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <unistd.h>
+#include "SizeRegistry.h"
+#include <charconv>
+#include <memory>
+#include <string_view>
+#include <thread>
 
-void handle_client(int client_fd, const Graph& graph)
-{
-  Dout(dc::notice, "New client connected, fd=" << client_fd);
-
-  char buffer[4096];
-  ssize_t bytes_received;
+inline namespace SIZE_NAMESPACE {
 
-  while ((bytes_received = recv(client_fd, buffer, sizeof(buffer), 0)) > 0)
+// The main function of mmap_server for one size (see SizeRegistry.h).
+int serve(int argc, char* argv[])
+{
+  // Command line options.
+  int number_of_threads = std::max(1U, std::thread::hardware_concurrency());    // The number of worker threads.
+  int number_of_shm_threads = 1;        // The number of threads serving the shared memory interface (zero disables it), see ProbeRing.h.
+  std::filesystem::path tablebase_filename;     // If empty, use the tablebase in Graph::data_directory.
+  for (int i = 1; i < argc; ++i)
   {
-    Dout(dc::notice, "Received " << bytes_received << " bytes from client");
-
-    // Check if we received a multiple of sizeof(Board).
-    ASSERT(bytes_received % sizeof(UncompressedBoard) == 0);
-
-    int num_boards = bytes_received / sizeof(UncompressedBoard);
-    Dout(dc::notice, "Processing " << num_boards << " board(s)");
-
-    // Process each board and collect UncompressedInfo objects.
-    std::vector<UncompressedInfo> data;
-    data.reserve(num_boards * 2); // black and white to move for each board.
-
-    for (int i = 0; i < num_boards; ++i)
+    std::string_view const arg = argv[i];
+    std::string_view const threads_option = "--threads=";
+    std::string_view const shm_threads_option = "--shm-threads=";
+    std::string_view const tablebase_option = "--tablebase=";
+    if (arg.starts_with(threads_option) &&
+        std::from_chars(arg.data() + threads_option.size(), arg.data() + arg.size(), number_of_threads).ec == std::errc{} &&
+        number_of_threads > 0)
+      continue;
+    if (arg.starts_with(shm_threads_option) &&
+        std::from_chars(arg.data() + shm_threads_option.size(), arg.data() + arg.size(), number_of_shm_threads).ec == std::errc{} &&
+        number_of_shm_threads >= 0 && number_of_shm_threads <= static_cast<int>(probe_ring::max_server_threads))
+      continue;
+    if (arg.starts_with(tablebase_option) && arg.size() > tablebase_option.size())
     {
-      UncompressedBoard uncompressed_board;
-      std::memcpy(&uncompressed_board, buffer + i * sizeof(UncompressedBoard), sizeof(UncompressedBoard));
-      Board board({uncompressed_board.bkx, uncompressed_board.bky},
-          {uncompressed_board.wkx, uncompressed_board.wky}, {uncompressed_board.wrx, uncompressed_board.wry});
-
-      Dout(dc::notice, "Processing board " << i << ": " << board);
-
-      Info const& black_to_move_info = graph.get_info<black>(board);
-      Info const& white_to_move_info = graph.get_info<white>(board);
-
-      UncompressedInfo black_to_move_uncompressed_info{black_to_move_info.classification().ply_encoded(), black_to_move_info.classification().bits(), black_to_move_info.number_of_children()};
-      UncompressedInfo white_to_move_uncompressed_info{white_to_move_info.classification().ply_encoded(), white_to_move_info.classification().bits(), white_to_move_info.number_of_children()};
-
-      data.push_back(black_to_move_uncompressed_info);
-      data.push_back(white_to_move_uncompressed_info);
-
-      Dout(dc::notice, "Board " << i << " classifications: black=" << black_to_move_info << ", white=" << white_to_move_info);
+      tablebase_filename = arg.substr(tablebase_option.size());
+      continue;
     }
-
-    // Send back all classifications.
-    size_t response_size = data.size() * sizeof(UncompressedInfo);
-    ssize_t bytes_sent = send(client_fd, data.data(), response_size, 0);
-
-    ASSERT(bytes_sent == static_cast<ssize_t>(response_size));
-    Dout(dc::notice, "Sent " << bytes_sent << " bytes (" << data.size() << " classifications)");
+    std::cerr << "Usage: " << argv[0] << " [--size=<BXxBYxPXxPY>] [--tablebase=<filename>] [--threads=<number of worker threads>] [--shm-threads=<0.." << probe_ring::max_server_threads << ">]" << std::endl;
+    return 1;
   }
 
-  if (bytes_received == -1)
-    Dout(dc::warning, "recv() error: " << strerror(errno));
-  else
-    Dout(dc::notice, "Client disconnected");
-
-  close(client_fd);
-}
-
-int main()
-{
-  Debug(NAMESPACE_DEBUG::init());
-
   Dout(dc::notice, "sizeof(Board) = " << sizeof(Board));
   Dout(dc::notice, "sizeof(UncompressedBoard) = " << sizeof(UncompressedBoard));
-  Dout(dc::notice, "sizeof(Info) = " << sizeof(Info));
   Dout(dc::notice, "sizeof(UncompressedInfo) = " << sizeof(UncompressedInfo));
   Dout(dc::notice, "sizeof(Classification) = " << sizeof(Classification));
 
@@ -92,85 +63,48 @@ int main()
 
   try
   {
-    std::filesystem::path const prefix_directory = "/opt/ext4/nvme1/infchessKRvK";
-    std::filesystem::path const data_directory = Graph::data_directory(prefix_directory);
-    std::filesystem::path const data_filename = Graph::data_filename(prefix_directory);
-    bool const file_exists = std::filesystem::exists(data_filename);
+    if (tablebase_filename.empty())
+    {
+      std::filesystem::path const prefix_directory = "/opt/ext4/nvme1/infchessKRvK";
+      tablebase_filename = Tablebase::filename(Graph::data_directory(prefix_directory));
+    }
+    bool const file_exists = std::filesystem::exists(tablebase_filename);
 
     if (!file_exists)
     {
-      std::cerr << "The file " << data_filename << " does not exist!" << std::endl;
+      std::cerr << "The file " << tablebase_filename << " does not exist! Run infchess2 to create it." << std::endl;
       return 1;
     }
 
-    Dout(dc::notice, "Using existing file " << data_filename << ".");
+    Dout(dc::notice, "Using existing file " << tablebase_filename << ".");
 
     auto start = std::chrono::high_resolution_clock::now();
 
-    // Only a new file is zero initialized.
-    Graph const graph(prefix_directory, true);
+    Tablebase const tablebase(tablebase_filename);
 
     auto end = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-    std::cout << "Execution time (creating object Graph): " << (duration.count() / 1000000.0) << " seconds\n";
+    std::cout << "Execution time (mapping the tablebase): " << (duration.count() / 1000000.0) << " seconds\n";
 
     // Set up socket server.
     int const port = 2000 + board_size_x;
     Dout(dc::notice, "Starting server on localhost:" << port);
 
-    int server_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_fd == -1)
-    {
-      std::cerr << "Failed to create socket: " << strerror(errno) << std::endl;
-      return 1;
-    }
-    auto&& close_fd = at_scope_end([server_fd]{ ::close(server_fd); });
+    QueryServer server(tablebase, port, number_of_threads);
 
-    // Allow reuse of address.
-    int opt = 1;
-    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == -1)
+    // Clients on the same host can use shared memory instead.
+    std::unique_ptr<ProbeRingServer> probe_ring_server;
+    if (number_of_shm_threads > 0)
     {
-      std::cerr << "setsockopt failed: " << strerror(errno) << std::endl;
-      return 1;
+      probe_ring_server = std::make_unique<ProbeRingServer>(tablebase, number_of_shm_threads);
+      std::cout << "Serving shared memory object " << probe_ring_server->name() << " with " << number_of_shm_threads << " thread(s)" << std::endl;
     }
 
-    struct sockaddr_in server_addr;
-    std::memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_addr.s_addr = inet_addr("127.0.0.1");
-    server_addr.sin_port = htons(port);
-
-    if (bind(server_fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) == -1)
-    {
-      std::cerr << "Failed to bind socket: " << strerror(errno) << std::endl;
-      return 1;
-    }
-
-    if (listen(server_fd, 5) == -1)
-    {
-      std::cerr << "Failed to listen on socket: " << strerror(errno) << std::endl;
-      return 1;
-    }
-
-    std::cout << "Server listening on localhost:" << port << std::endl;
+    std::cout << "Server listening on localhost:" << port << " with " << number_of_threads << " worker threads" << std::endl;
     std::cout << "Ready to accept connections..." << std::endl;
 
-    // Accept connections and handle clients.
-    while (true)
-    {
-      struct sockaddr_in client_addr;
-      socklen_t client_addr_len = sizeof(client_addr);
-
-      int client_fd = accept(server_fd, (struct sockaddr*)&client_addr, &client_addr_len);
-      if (client_fd == -1)
-      {
-        Dout(dc::warning, "Failed to accept connection: " << strerror(errno));
-        continue;
-      }
-
-      // Handle client in the same thread (single-threaded server).
-      handle_client(client_fd, graph);
-    }
+    // Accept connections and handle clients; print the latency percentiles every ten seconds.
+    server.run(std::chrono::seconds(10));
   }
   catch (AIAlert::Error const& error)
   {
@@ -178,3 +112,7 @@ int main()
     return 1;
   }
 }
+
+SizeRegistry::Registration const registration(Size::Bx, Size::By, Size::Px, Size::Py, &serve);
+
+} // namespace SIZE_NAMESPACE
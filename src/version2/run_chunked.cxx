@@ -0,0 +1,60 @@
+#include "sys.h"
+#include "run_chunked.h"
+#include "run_tasks.h"
+#include <algorithm>
+#include <atomic>
+#include "debug.h"
+
+ChunkedRunTimes::clock_type::duration ChunkedRunTimes::idle_time() const
+{
+  clock_type::duration idle{};
+  for (clock_type::duration busy : busy_time)
+    idle += wall_time - busy;
+  return idle;
+}
+
+double ChunkedRunTimes::idle_fraction() const
+{
+  if (busy_time.empty() || wall_time.count() == 0)
+    return 0.0;
+  return static_cast<double>(idle_time().count()) / (static_cast<double>(wall_time.count()) * busy_time.size());
+}
+
+ChunkedRunTimes& ChunkedRunTimes::operator+=(ChunkedRunTimes const& times)
+{
+  wall_time += times.wall_time;
+  if (busy_time.empty())
+    busy_time.resize(times.busy_time.size());
+  ASSERT(busy_time.size() == times.busy_time.size());
+  for (size_t task_n = 0; task_n < busy_time.size(); ++task_n)
+    busy_time[task_n] += times.busy_time[task_n];
+  return *this;
+}
+
+ChunkedRunTimes run_chunked(AIThreadPool& thread_pool, AIQueueHandle queue_handle, int number_of_tasks,
+    size_t number_of_items, size_t min_chunk_size, std::function<void(int, size_t, size_t)> const& chunk_body)
+{
+  ASSERT(min_chunk_size > 0);
+  ChunkedRunTimes times;
+  times.busy_time.resize(number_of_tasks);
+
+  std::atomic<size_t> next_item = 0;
+  auto const start = ChunkedRunTimes::clock_type::now();
+  run_tasks(thread_pool, queue_handle, number_of_tasks, [&](int task_n){
+    auto const task_start = ChunkedRunTimes::clock_type::now();
+    for (;;)
+    {
+      // Guided scheduling: take a fraction of what is left, so that the last chunks are small.
+      size_t const remaining = number_of_items - std::min(number_of_items, next_item.load(std::memory_order_relaxed));
+      size_t const chunk_size = std::max(min_chunk_size, remaining / (2 * number_of_tasks));
+      size_t const begin = next_item.fetch_add(chunk_size, std::memory_order_relaxed);
+      if (begin >= number_of_items)
+        break;
+      chunk_body(task_n, begin, std::min(begin + chunk_size, number_of_items));
+    }
+    times.busy_time[task_n] = ChunkedRunTimes::clock_type::now() - task_start;
+  });
+  times.wall_time = ChunkedRunTimes::clock_type::now() - start;
+
+  return times;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "threadpool/AIThreadPool.h"
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// Timing of a single call to run_chunked.
+struct ChunkedRunTimes
+{
+  using clock_type = std::chrono::steady_clock;
+
+  clock_type::duration wall_time{};             // The time from starting the first task till the last task finished.
+  std::vector<clock_type::duration> busy_time;  // Per task, the time that it was running (and had work to do).
+
+  // The summed time that tasks were not running (still in the queue, or waiting for the last task to finish).
+  clock_type::duration idle_time() const;
+  // The idle time as a fraction of the total available time (number of tasks times wall_time).
+  double idle_fraction() const;
+
+  // Add the times of a subsequent run with the same number of tasks.
+  ChunkedRunTimes& operator+=(ChunkedRunTimes const& times);
+};
+
+// Process the items [0, number_of_items) using `number_of_tasks` tasks in the thread pool, and wait until all of them are done.
+//
+// The tasks take chunks of consecutive items from a shared atomic cursor, calling `chunk_body(task_n, begin, end)` for each chunk.
+// The chunk size starts large and shrinks as fewer items remain (but is never less than `min_chunk_size`),
+// so that tasks that happen to get expensive items don't cause the others to wait at the end.
+// The queue must have room for at least `number_of_tasks` tasks.
+ChunkedRunTimes run_chunked(AIThreadPool& thread_pool, AIQueueHandle queue_handle, int number_of_tasks,
+    size_t number_of_items, size_t min_chunk_size, std::function<void(int, size_t, size_t)> const& chunk_body);
@@ -0,0 +1,65 @@
+#include "sys.h"
+#include "run_tasks.h"
+#include "Trace.h"
+#include "utils/threading/Gate.h"
+#include <atomic>
+#include "debug.h"
+
+void run_tasks(AIThreadPool& thread_pool, AIQueueHandle queue_handle, int number_of_tasks, std::function<void(int)> const& task_body)
+{
+  if (number_of_tasks == 0)
+    return;
+
+  // The tasks are named after the phase of the caller on the timeline (see Trace.h).
+  bool const tracing = Trace::enabled();
+  std::string const phase = tracing ? Trace::current_phase() : std::string{};
+
+  utils::threading::Gate until_all_tasks_finished;
+  std::atomic_int unfinished_tasks = number_of_tasks;
+  for (int task_n = 0; task_n < number_of_tasks; ++task_n)
+  {
+    Trace::clock_type::time_point const queued = tracing ? Trace::clock_type::now() : Trace::clock_type::time_point{};
+    auto task = [task_n, &task_body, &unfinished_tasks, &until_all_tasks_finished, tracing, &phase, queued](){
+      if (!tracing)
+        task_body(task_n);
+      else
+      {
+        auto const begin = Trace::clock_type::now();
+        task_body(task_n);
+        auto const queue_delay = std::chrono::duration<double, std::micro>(begin - queued).count();
+        Trace::complete(phase.empty() ? "task" : phase, "task", begin, Trace::clock_type::now(),
+            "{\"task\":" + std::to_string(task_n) + ",\"queue_delay_us\":" + std::to_string(queue_delay) + "}");
+      }
+      // If this was the last one, open the 'until_all_tasks_finished' gate.
+      if (unfinished_tasks-- == 1)
+        until_all_tasks_finished.open();
+      // We're done.
+      return false;
+    };
+    {
+      // Get read access to AIThreadPool::m_queues.
+      auto queues_access = thread_pool.queues_read_access();
+      // Get a reference to one of the queues in m_queues.
+      auto& queue = thread_pool.get_queue(queues_access, queue_handle);
+      bool queue_full;
+      {
+        // Get producer accesses to this queue.
+        auto queue_access = queue.producer_access();
+        int length = queue_access.length();
+        queue_full = length == queue.capacity();
+        // I thought the queue was large enough?!
+        ASSERT(!queue_full);
+        if (!queue_full)
+        {
+          // Place a lambda in the queue.
+          queue_access.move_in(task);
+        }
+      } // Release producer accesses, so another thread can write to this queue again.
+      // This function must be called every time move_in was called
+      // on a queue that was returned by thread_pool.get_queue.
+      if (!queue_full) // Was move_in called?
+        queue.notify_one();
+    } // Release read access to AIThreadPool::m_queues so another thread can use AIThreadPool::new_queue again.
+  }
+  until_all_tasks_finished.wait();
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "threadpool/AIThreadPool.h"
+#include <functional>
+
+// Run `number_of_tasks` tasks in the thread pool and wait until all of them finished.
+// The task with number task_n calls `task_body(task_n)`, for task_n in [0, number_of_tasks).
+// The queue must have room for at least `number_of_tasks` tasks.
+void run_tasks(AIThreadPool& thread_pool, AIQueueHandle queue_handle, int number_of_tasks, std::function<void(int)> const& task_body);
@@ -0,0 +1,11 @@
+#include "sys.h"
+#include "SizeRegistry.h"
+#include "debug.h"
+
+// The main function of the programs that are compiled for more than one size (see SizeRegistry.h).
+// INFCHESS_DEFAULT_SIZE is defined in CMakeLists.txt (the first of INFCHESS_SIZES).
+int main(int argc, char* argv[])
+{
+  Debug(NAMESPACE_DEBUG::init());
+  return SizeRegistry::main(argc, argv, INFCHESS_DEFAULT_SIZE);
+}
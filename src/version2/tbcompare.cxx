@@ -0,0 +1,295 @@
+#include "sys.h"
+#include "TablebaseView.h"
+#include "run_chunked.h"
+#include "utils/AIAlert.h"
+#include "utils/debug_ostream_operators.h"
+#include "threadpool/AIThreadPool.h"
+#include <algorithm>
+#include <charconv>
+#include <iomanip>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "debug.h"
+
+// Compare two solved tables (see Tablebase.h) that may have been solved with a different block size and/or board size.
+//
+// Only the positions where all pieces are on both boards are compared (the pieces are placed relative to the bottom-left
+// corner of both boards). The tables are mapped directly (see TablebaseView.h), the black king squares are distributed
+// over the threads of a thread pool, and a whole row of rook squares is compared at once.
+
+namespace {
+
+struct Position
+{
+  int bkx, bky, wkx, wky, wrx, wry;
+  color_type to_move;
+};
+
+std::ostream& operator<<(std::ostream& os, Position const& p)
+{
+  return os << "black king: " << p.bkx << ", " << p.bky << "; white king: " << p.wkx << ", " << p.wky <<
+    "; white rook: " << p.wrx << ", " << p.wry << " (" << (p.to_move == black ? "black" : "white") << " to move)";
+}
+
+// A position with the largest (or smallest) value of something.
+struct Extreme
+{
+  int value;
+  Position position;
+  bool found = false;
+
+  void update_max(int new_value, Position const& new_position)
+  {
+    if (found && new_value <= value)
+      return;
+    value = new_value;
+    position = new_position;
+    found = true;
+  }
+
+  void update_min(int new_value, Position const& new_position)
+  {
+    if (found && new_value >= value)
+      return;
+    value = new_value;
+    position = new_position;
+    found = true;
+  }
+};
+
+// The result of comparing (part of) the positions.
+struct Statistics
+{
+  size_t legal = 0;                     // The number of positions that are legal in both tables.
+  size_t draws = 0;                     // The number of legal positions without a known ply in both tables.
+  size_t bits_mismatches = 0;           // The number of positions whose classification bits differ.
+  size_t only_in_a = 0;                 // The number of positions with a known ply in table A only.
+  size_t only_in_b = 0;                 // The number of positions with a known ply in table B only.
+  std::vector<size_t> histogram;        // The number of positions per ply(A) - ply(B), offset by max_ply of B.
+  Extreme max_diff;                     // The position with the largest ply(A) - ply(B).
+  Extreme min_diff;                     // The position with the smallest ply(A) - ply(B).
+  Extreme min_ply_only_in_a;            // The position with the smallest ply that is only known in table A.
+  Extreme min_ply_only_in_b;            // The position with the smallest ply that is only known in table B.
+  Extreme bits_mismatch;                // An example of a position whose classification bits differ.
+
+  Statistics(size_t histogram_size) : histogram(histogram_size) { }
+
+  Statistics& operator+=(Statistics const& stats)
+  {
+    legal += stats.legal;
+    draws += stats.draws;
+    bits_mismatches += stats.bits_mismatches;
+    only_in_a += stats.only_in_a;
+    only_in_b += stats.only_in_b;
+    for (size_t i = 0; i < histogram.size(); ++i)
+      histogram[i] += stats.histogram[i];
+    for (auto [extreme, other] : {std::pair{&max_diff, &stats.max_diff}, std::pair{&bits_mismatch, &stats.bits_mismatch}})
+      if (other->found)
+        extreme->update_max(other->value, other->position);
+    for (auto [extreme, other] : {std::pair{&min_diff, &stats.min_diff},
+        std::pair{&min_ply_only_in_a, &stats.min_ply_only_in_a}, std::pair{&min_ply_only_in_b, &stats.min_ply_only_in_b}})
+      if (other->found)
+        extreme->update_min(other->value, other->position);
+    return *this;
+  }
+};
+
+class Comparator
+{
+ private:
+  TablebaseView const& a_;
+  TablebaseView const& b_;
+  int width_;                           // The size of the overlapping part of both boards.
+  int height_;
+  int histogram_offset_;                // The index into Statistics::histogram of a zero ply difference.
+
+ public:
+  Comparator(TablebaseView const& a, TablebaseView const& b) :
+    a_(a), b_(b),
+    width_(std::min(a.board_size_x(), b.board_size_x())), height_(std::min(a.board_size_y(), b.board_size_y())),
+    histogram_offset_(b.header().max_ply) { }
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+  size_t histogram_size() const { return a_.header().max_ply + b_.header().max_ply + 1; }
+  int histogram_offset() const { return histogram_offset_; }
+
+  // Compare all positions with the black king on square `bk` (x + width * y).
+  void compare_black_king(size_t bk, Statistics& stats) const;
+
+ private:
+  void compare_row(uint32_t const* row_a, uint32_t const* row_b, Position position, Statistics& stats) const;
+};
+
+void Comparator::compare_black_king(size_t bk, Statistics& stats) const
+{
+  std::vector<uint32_t> row_a(width_);
+  std::vector<uint32_t> row_b(width_);
+  Position position;
+  position.bkx = bk % width_;
+  position.bky = bk / width_;
+  for (position.wky = 0; position.wky < height_; ++position.wky)
+    for (position.wkx = 0; position.wkx < width_; ++position.wkx)
+      for (int to_move = 0; to_move < 2; ++to_move)
+      {
+        position.to_move = static_cast<color_type>(to_move);
+        for (position.wry = 0; position.wry < height_; ++position.wry)
+        {
+          a_.get_row(position.to_move, position.bkx, position.bky, position.wkx, position.wky, position.wry, width_, row_a.data());
+          b_.get_row(position.to_move, position.bkx, position.bky, position.wkx, position.wky, position.wry, width_, row_b.data());
+          compare_row(row_a.data(), row_b.data(), position, stats);
+        }
+      }
+}
+
+void Comparator::compare_row(uint32_t const* __restrict__ row_a, uint32_t const* __restrict__ row_b, Position position, Statistics& stats) const
+{
+  // Nearly all rows are identical; find those with a loop that the compiler turns into SIMD instructions.
+  uint32_t differences = 0;
+  uint32_t number_of_mates = 0;
+  uint32_t number_of_legal = 0;
+  for (int i = 0; i < width_; ++i)
+  {
+    uint32_t const entry = row_a[i];
+    differences |= entry ^ row_b[i];
+    number_of_legal += (entry & TablebaseView::legal) >> 4;
+    number_of_mates += ((entry & TablebaseView::legal) >> 4) & (entry >> TablebaseView::mate_in_ply_shift != 0);
+  }
+  static_assert(TablebaseView::legal == 1 << 4);
+  if (differences == 0)
+  {
+    stats.legal += number_of_legal;
+    stats.draws += number_of_legal - number_of_mates;
+    stats.histogram[histogram_offset_] += number_of_mates;
+    return;
+  }
+
+  // Look at each position of a row that differs.
+  for (position.wrx = 0; position.wrx < width_; ++position.wrx)
+  {
+    uint32_t const entry_a = row_a[position.wrx];
+    uint32_t const entry_b = row_b[position.wrx];
+    if ((entry_a & TablebaseView::bits_mask) != (entry_b & TablebaseView::bits_mask))
+    {
+      ++stats.bits_mismatches;
+      if (!stats.bits_mismatch.found)
+        stats.bits_mismatch.update_max(0, position);
+      continue;
+    }
+    if (!TablebaseView::is_legal(entry_a))
+      continue;
+    ++stats.legal;
+    int const ply_a = TablebaseView::ply(entry_a);
+    int const ply_b = TablebaseView::ply(entry_b);
+    if (ply_a == -1 && ply_b == -1)
+      ++stats.draws;
+    else if (ply_b == -1)
+    {
+      ++stats.only_in_a;
+      stats.min_ply_only_in_a.update_min(ply_a, position);
+    }
+    else if (ply_a == -1)
+    {
+      ++stats.only_in_b;
+      stats.min_ply_only_in_b.update_min(ply_b, position);
+    }
+    else
+    {
+      int const diff = ply_a - ply_b;
+      ++stats.histogram[histogram_offset_ + diff];
+      stats.max_diff.update_max(diff, position);
+      stats.min_diff.update_min(diff, position);
+    }
+  }
+}
+
+void print_extreme(char const* description, Extreme const& extreme)
+{
+  if (extreme.found)
+    std::cout << description << ": " << extreme.value << " at " << extreme.position << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  // Command line options.
+  int number_of_threads = std::max(1U, std::thread::hardware_concurrency());
+  std::vector<std::filesystem::path> data_directories;
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string_view const arg = argv[i];
+    std::string_view const threads_option = "--threads=";
+    if (arg.starts_with(threads_option))
+    {
+      if (std::from_chars(arg.data() + threads_option.size(), arg.data() + arg.size(), number_of_threads).ec == std::errc{} &&
+          number_of_threads > 0)
+        continue;
+    }
+    else if (!arg.starts_with("-"))
+    {
+      data_directories.emplace_back(arg);
+      continue;
+    }
+    data_directories.clear();
+    break;
+  }
+  if (data_directories.size() != 2)
+  {
+    std::cerr << "Usage: " << argv[0] << " [--threads=<number of threads>] <data directory A> <data directory B>" << std::endl;
+    return 1;
+  }
+
+  try
+  {
+    TablebaseView const a(TablebaseHeader::filename(data_directories[0]));
+    TablebaseView const b(TablebaseHeader::filename(data_directories[1]));
+    Comparator const comparator(a, b);
+    for (auto [name, view] : {std::pair{"A", &a}, std::pair{"B", &b}})
+    {
+      TablebaseHeader const& header = view->header();
+      std::cout << name << ": " << view->board_size_x() << "x" << view->board_size_y() << " board, " <<
+        header.Px << "x" << header.Py << " blocks of " << header.Bx << "x" << header.By << " squares; max ply " << header.max_ply << std::endl;
+    }
+    std::cout << "Comparing all positions on the bottom-left " << comparator.width() << "x" << comparator.height() <<
+      " squares using " << number_of_threads << " threads." << std::endl;
+
+    AIThreadPool thread_pool(number_of_threads);
+    AIQueueHandle queue_handle = thread_pool.new_queue(number_of_threads + 1);
+
+    // One Statistics object per task, so that the tasks don't share anything that they write to.
+    std::vector<Statistics> task_stats(number_of_threads, Statistics{comparator.histogram_size()});
+    ChunkedRunTimes const times = run_chunked(thread_pool, queue_handle, number_of_threads,
+        static_cast<size_t>(comparator.width()) * comparator.height(), 1, [&](int task_n, size_t begin, size_t end){
+      for (size_t bk = begin; bk < end; ++bk)
+        comparator.compare_black_king(bk, task_stats[task_n]);
+    });
+    Statistics stats(comparator.histogram_size());
+    for (Statistics const& s : task_stats)
+      stats += s;
+
+    std::cout << "Compared " << stats.legal << " legal positions in " <<
+      std::chrono::duration_cast<std::chrono::milliseconds>(times.wall_time).count() << " ms." << std::endl;
+    std::cout << "Draw in both: " << stats.draws << std::endl;
+    std::cout << "Classification differs: " << stats.bits_mismatches << std::endl;
+    print_extreme("  for example", stats.bits_mismatch);
+    std::cout << "Mate only in A: " << stats.only_in_a << std::endl;
+    print_extreme("  smallest ply", stats.min_ply_only_in_a);
+    std::cout << "Mate only in B: " << stats.only_in_b << std::endl;
+    print_extreme("  smallest ply", stats.min_ply_only_in_b);
+    std::cout << "Histogram of ply(A) - ply(B):" << std::endl;
+    for (size_t i = 0; i < stats.histogram.size(); ++i)
+      if (stats.histogram[i] > 0)
+        std::cout << std::setw(6) << static_cast<int>(i) - comparator.histogram_offset() << ": " << stats.histogram[i] << std::endl;
+    print_extreme("Largest ply(A) - ply(B)", stats.max_diff);
+    print_extreme("Smallest ply(A) - ply(B)", stats.min_diff);
+  }
+  catch (AIAlert::Error const& error)
+  {
+    std::cerr << error << std::endl;
+    return 1;
+  }
+}